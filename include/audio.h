@@ -0,0 +1,68 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <pthread.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <alsa/asoundlib.h>
+
+#include "defs.h"
+#include "synth.h"
+#include "record.h"
+#include "control.h"
+#include "stats.h"
+
+/*
+ * Audio engine structure
+ * Owns the ALSA PCM handle and the audio thread rendering the synth
+ * The synth_t state is only touched by the audio thread, the GUI thread
+ * talks to it through the control transport, so the audio thread never waits for a lock
+ * The recorded samples are handed to the GUI thread through the record ring buffer
+ * The sound card plays at the sample rate, the audio thread writes a period of samples
+ * at a time in a buffer of periods periods
+ * With mmap, the samples are rendered straight into the sound card buffer,
+ * else they are copied into it by a write
+ * The audio thread waits for a free period on the poll descriptors of the sound card
+ * It runs with the SCHED_FIFO priority if priority isn't 0, on the CPU core cpu if it isn't -1
+ * The scope holds the last FRAMES played samples, shown by the GUI
+ * The stats are the xruns and timings of the audio thread, read by any thread
+ */
+typedef struct
+{
+    snd_pcm_t *handle;
+    int rate, period, periods;
+    bool mmap;
+    struct pollfd fds[AUDIO_POLL_FDS];
+    int nfds;
+    int priority, cpu;
+    short scope[FRAMES];
+    audio_stats_t stats;
+    synth_t *synth;
+    control_t *control;
+    pthread_t thread;
+    atomic_bool running;
+    atomic_bool recording;
+    record_ring_t *record;
+} audio_t;
+
+/*
+ * Open the default ALSA playback device with the sample rate, period and periods
+ * The period and periods are set to the nearest ones the device accepts,
+ * the access is memory mapped if the device supports it
+ * Returns 1 if the device can't be opened or doesn't support the parameters
+ */
+int audio_open(audio_t *audio);
+
+/*
+ * Start the audio thread, with its real-time priority and CPU core if set
+ * Returns 1 if the thread couldn't be created
+ */
+int audio_start(audio_t *audio);
+
+/* Stop the audio thread and wait for it to finish */
+void audio_stop(audio_t *audio);
+
+/* Drain and close the ALSA playback device */
+void audio_close(audio_t *audio);
+
+#endif
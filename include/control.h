@@ -0,0 +1,126 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "defs.h"
+#include "synth.h"
+
+/* Note events sent to the audio thread */
+typedef enum
+{
+    EVENT_NOTE_ON,
+    EVENT_NOTE_OFF,
+    EVENT_RESET
+} synth_event_type_t;
+
+/* Note event, the velocity is only used by the note on */
+typedef struct
+{
+    synth_event_type_t type;
+    int note, velocity;
+} synth_event_t;
+
+/*
+ * State of the synth shown by the GUI, published by the audio thread after each block
+ * The scope holds the last FRAMES rendered samples, whatever the period
+ * The LFO variables are the modulated parameters at the end of the block
+ * The pressed array tells if each MIDI note is pressed,
+ * the arp note is the note played by the arpeggiator, -1 if none
+ */
+typedef struct
+{
+    short scope[FRAMES];
+    float lfo_amp, lfo_detune, lfo_cutoff;
+    bool pressed[MIDI_NOTES];
+    int arp_note;
+} synth_display_t;
+
+/*
+ * Single producer, single consumer queue of note events
+ * The head is only written by the producer and the tail only by the consumer
+ */
+typedef struct
+{
+    synth_event_t events[CONTROL_EVENTS];
+    atomic_uint head, tail;
+} event_queue_t;
+
+/*
+ * Triple buffer indices, the writer and the reader own a slot each
+ * and the third one is exchanged through the state,
+ * with the TRIPLE_FRESH bit set when it holds a slot the reader hasn't taken yet
+ * Neither side ever waits for the other, the reader always gets a whole slot
+ */
+typedef struct
+{
+    atomic_uint state;
+    unsigned int write, read;
+} triple_buffer_t;
+
+/*
+ * Lock-free transport between the GUI thread and the audio thread
+ * The parameters go to the audio thread through a triple buffer,
+ * the audio thread takes the newest complete set at the start of each block
+ * The note events go through a queue from the GUI thread and another one from the MIDI thread,
+ * so that each of them has a single producer
+ * The display state comes back to the GUI through another triple buffer
+ */
+typedef struct
+{
+    synth_params_t params[3];
+    triple_buffer_t params_buffer;
+    event_queue_t gui_events, midi_events;
+    synth_display_t display[3];
+    triple_buffer_t display_buffer;
+} control_t;
+
+/* Initialize the transport with the first parameters and an empty display */
+void control_init(control_t *control, const synth_params_t *params);
+
+/* Publish a copy of the parameters to the audio thread, never blocks */
+void control_publish_params(control_t *control, const synth_params_t *params);
+
+/*
+ * Take the newest parameters published by the GUI thread
+ * Returns the parameters, valid until the next call
+ */
+const synth_params_t *control_acquire_params(control_t *control);
+
+/*
+ * Push a note event from the GUI thread to the audio thread, never blocks
+ * Returns 1 if the queue is full and the event was dropped
+ */
+int control_push_event(control_t *control, synth_event_type_t type,
+                       int note, int velocity);
+
+/*
+ * Push a note event from the MIDI thread to the audio thread, never blocks
+ * Returns 1 if the queue is full and the event was dropped
+ */
+int control_push_midi_event(control_t *control, synth_event_type_t type,
+                            int note, int velocity);
+
+/*
+ * Pop the oldest note event of the GUI thread, else of the MIDI thread
+ * Returns false if both queues are empty
+ */
+bool control_pop_event(control_t *control, synth_event_t *event);
+
+/*
+ * Returns the display slot owned by the audio thread,
+ * to be filled whole before calling control_publish_display
+ */
+synth_display_t *control_display_slot(control_t *control);
+
+/* Publish the filled display slot to the GUI thread, never blocks */
+void control_publish_display(control_t *control);
+
+/*
+ * Take the newest display state published by the audio thread
+ * Returns the display state, valid until the next call
+ */
+const synth_display_t *control_acquire_display(control_t *control);
+
+#endif
@@ -44,6 +44,10 @@
 #define NOTE_ON 0x90
 #define NOTE_OFF 0x80
 #define KNOB_TURNED 0xB0
+#define PITCH_BEND 0xE0
+#define PITCH_BEND_CENTER 8192
+#define MIDI_NOTES 128
+#define MIDI_CONTROLLERS 128
 
 /* CC Values for the Arturia Keylab Essential 61 knobs */
 /* ADSR parameters knobs */
@@ -64,26 +68,163 @@
 
 /* Note and synth related */
 #define VOICES 6
+#define MIN_VOICES 1
+#define MAX_VOICES 256
 #define DEFAULT_OCTAVE 4
+#define MIN_OCTAVE 0
+#define MAX_OCTAVE 9
 #define A_4 440
-#define RATE 44100
 #define DEFAULT_AMPLITUDE 0.5
 #define A4_POSITION 57
 
+/*
+ * Pitch modulations
+ * The oscillators B and C are detuned up and down by DETUNE_CENTS at full detune
+ * The pitch bend range is in semitones, the glide time in seconds
+ */
+#define DETUNE_CENTS 20.0
+#define PITCH_BEND_RANGE 2.0
+#define MAX_GLIDE 1.0
+
+/* Voice stealing policies, when every voice is busy */
+#define STEAL_OLDEST 0
+#define STEAL_QUIETEST 1
+#define STEAL_RELEASED 2
+#define STEAL_FADE_VOICES 8
+#define STEAL_FADE_TIME 0.005
+
+/*
+ * Overshoot of the exponential envelope segments, past the level they stop at
+ * The attack aims above 1.0, the decay and release aim below their level
+ */
+#define ENV_ATTACK_RATIO 0.3
+#define ENV_DECAY_RATIO 0.0001
+
+/* Cache line size in bytes and in floats, used to align the voices pool */
+#define CACHE_LINE 64
+#define CACHE_LINE_FLOATS (CACHE_LINE / 4)
+
 /* Oscillators waveforms */
 #define SINE_WAVE 0
 #define SQUARE_WAVE 1
 #define TRIANGLE_WAVE 2
 #define SAWTOOTH_WAVE 3
 
-/* ALSA buffering and latency */
+/*
+ * Filter types, the one-pole low-pass, the 2-pole state-variable filter modes
+ * and the 4-pole resonant ladder, FILTER_STAGES is the most states a filter needs
+ */
+#define ONE_POLE_FILTER 0
+#define SVF_LOWPASS 1
+#define SVF_HIGHPASS 2
+#define SVF_BANDPASS 3
+#define SVF_NOTCH 4
+#define LADDER_FILTER 5
+#define FILTER_STAGES 4
+
+/* Cutoff frequency of the filters at a cutoff of 1.0, in Hz, an eighth of the default sample rate */
+#define FILTER_MAX_FREQ (DEFAULT_RATE / 8.0f)
+
+/* Wavetable oscillators, the size is a power of two */
+#define WAVETABLE_SIZE 2048
+#define WAVETABLE_MIN_SIZE 64
+#define WAVETABLE_MAX_SIZE 65536
+
+/* Highest frequency covered by the first band-limited wavetable level, in Hz */
+#define WAVETABLE_BASE_FREQ 20.0
+
+/* Oscillators are read from the wavetables by default when set to 1 at build time */
+#ifndef WAVETABLE_DEFAULT
+#define WAVETABLE_DEFAULT 0
+#endif
+
+/*
+ * ALSA buffering and latency
+ * The sample rate is one of the SAMPLE_RATES, in Hz
+ * The period is the block of samples rendered and written at once, up to FRAMES,
+ * the sound card buffer holding periods of them, for a latency of periods * period / rate
+ * The low-latency mode picks the smallest buffer that usually plays without underruns
+ */
+#define DEFAULT_RATE 44100
+#define SAMPLE_RATES {44100, 48000, 96000, 192000}
 #define FRAMES 1024
-#define LATENCY 40000
+#define DEFAULT_PERIOD 1024
+#define MIN_PERIOD 32
+#define DEFAULT_PERIODS 2
+#define MIN_PERIODS 2
+#define MAX_PERIODS 32
+#define LOW_LATENCY_PERIOD 64
+#define LOW_LATENCY_PERIODS 2
 #define MAX_SAMPLES 512000
 #define MONO 1
 #define STEREO 2
 #define BITS 16
 
+/*
+ * Timing histograms, with STATS_SUB_BUCKETS buckets per power of two
+ * for the 32 bits values, past the first 2 * STATS_SUB_BUCKETS values
+ */
+#define STATS_SUB_BITS 5
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BITS)
+#define STATS_BUCKETS (STATS_SUB_BUCKETS * (33 - STATS_SUB_BITS))
+
+/*
+ * Real-time logging ring buffer size in messages, must be a power of two
+ * A message has up to RTLOG_ARGS arguments, each conversion is up to RTLOG_SPEC characters
+ * The logging thread writes the pending messages every RTLOG_FLUSH_MS milliseconds
+ */
+#define RTLOG_MESSAGES 1024
+#define RTLOG_ARGS 4
+#define RTLOG_SPEC 32
+#define RTLOG_FLUSH_MS 50
+
+/*
+ * Audio thread waits, the sound card poll descriptors and the poll timeout in milliseconds
+ * The real-time priority is the default SCHED_FIFO one, the stack size is the part
+ * of the stack of a real-time thread touched before it starts playing
+ * The threads are created with REALTIME_THREAD_STACK bytes of stack, instead of the
+ * default 8 MB that the memory locking would pin in RAM for each of them
+ */
+#define AUDIO_POLL_FDS 16
+#define AUDIO_POLL_TIMEOUT 1000
+#define REALTIME_PRIORITY 70
+#define REALTIME_STACK (256 * 1024)
+#define REALTIME_THREAD_STACK (512 * 1024)
+
+/*
+ * MIDI thread waits, the MIDI input poll descriptors and the poll timeout in milliseconds,
+ * after which the thread checks if it has to stop
+ */
+#define MIDI_POLL_FDS 4
+#define MIDI_POLL_TIMEOUT 100
+
+/* Recording ring buffer size in samples, must be a power of two */
+#define RECORD_RING_SIZE 65536
+
+/* Note events queue size from the GUI to the audio thread, must be a power of two */
+#define CONTROL_EVENTS 256
+
+/* Triple buffer state bit, set when the exchanged slot wasn't taken by the reader yet */
+#define TRIPLE_FRESH 4
+
+/*
+ * Control rate in samples, the modulations (LFO, filter envelope) are evaluated
+ * once per control tick and the parameters they drive ramp linearly in between
+ */
+#define CONTROL_RATE 32
+#define MIN_CONTROL_RATE 1
+#define MAX_CONTROL_RATE 256
+
+/* GUI frame rate, the audio thread runs at its own rate */
+#define FPS 60
+
+/*
+ * Voices rendering worker threads
+ * The voices are rendered in chunks of DSP_CHUNK_VOICES, whatever the threads count
+ */
+#define POOL_MAX_THREADS 16
+#define DSP_CHUNK_VOICES 32
+
 /* SDL interface */
 #define WIDTH 1769
 #define HEIGHT 800
@@ -0,0 +1,77 @@
+#ifndef DSP_H
+#define DSP_H
+
+#include "synth.h"
+#include "wavetable.h"
+#include "pool.h"
+
+/*
+ * Render the voices of the pool into the buffer, adding to its content
+ * Only the voices of the active list are rendered, they are gathered
+ * a SIMD vector at a time, one lane per voice
+ * The voices are split in chunks rendered by the worker pool if it isn't NULL,
+ * the chunks are always summed in the same order so the output doesn't depend on the pool
+ * The waveforms of the voices are read from the parameters,
+ * their envelopes from the envelope coefficients
+ * With the voice filters parameter, each voice goes through its own filter of the filter type,
+ * at the sample rate, its cutoff modulations being evaluated every control_rate samples
+ * The oscillators read the wavetables if they are not NULL
+ * If only_voice is not -1, the other voices are left untouched (arpeggiator),
+ * except the spare voices fading out the stolen ones
+ * The amp buffer holds the amplification of each sample
+ * If lfo is not NULL, it holds the LFO automation of the parameter it modulates,
+ * the detuned oscillators follow it between the base frequency and the one
+ * detuned by the detune ratio, the voice filters scale their cutoff by it
+ */
+void dsp_render_voices(voices_t *voices, const synth_params_t *params,
+                       const adsr_coefs_t *envelope, const adsr_coefs_t *filter_envelope,
+                       const wavetables_t *wavetables, pool_t *pool,
+                       float *buffer, const float *amp, const float *lfo,
+                       float detune_ratio, int rate, int control_rate,
+                       int only_voice, int nframes);
+
+/*
+ * Convert a buffer of samples to 16 bits samples
+ * The samples are clipped between -1.0 and 1.0 first
+ */
+void dsp_to_s16(const float *input, short *output, int nframes);
+
+/* Clip a buffer of 16 bits samples between -clip and clip, then apply the gain */
+void dsp_clip_s16(short *buffer, int nframes, short clip, float gain);
+
+/*
+ * Select the kernels of an instruction set : scalar, sse2, avx2 or avx512
+ * If name is NULL, the SYNTH_SIMD environment variable is read instead,
+ * if it isn't set either the fastest instruction set of the CPU is picked
+ * Returns 1 if the instruction set is unknown or not supported by the CPU
+ */
+int dsp_init(const char *name);
+
+/* Returns the name of the SIMD instruction set of the selected kernels */
+const char *dsp_simd_name(void);
+
+/*
+ * Kernels of an instruction set, defined by the dsp_<instruction set>.c files
+ * The name is the one shown to the user
+ */
+typedef struct
+{
+    const char *name;
+    void (*render_voices)(voices_t *voices, const synth_params_t *params,
+                          const adsr_coefs_t *envelope, const adsr_coefs_t *filter_envelope,
+                          const wavetables_t *wavetables, pool_t *pool,
+                          float *buffer, const float *amp, const float *lfo,
+                          float detune_ratio, int rate, int control_rate,
+                          int only_voice, int nframes);
+    void (*to_s16)(const float *input, short *output, int nframes);
+    void (*clip_s16)(short *buffer, int nframes, short clip, float gain);
+} dsp_kernels_t;
+
+extern const dsp_kernels_t dsp_kernels_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+extern const dsp_kernels_t dsp_kernels_sse2;
+extern const dsp_kernels_t dsp_kernels_avx2;
+extern const dsp_kernels_t dsp_kernels_avx512;
+#endif
+
+#endif
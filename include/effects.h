@@ -2,6 +2,6 @@
 #define EFFECTS_H
 
 /* Applies an amount of distortion onto a sound buffer */
-short distortion(short sample, float amount, bool overdriving);
+void distortion(short *buffer, int nframes, float amount, bool overdriving);
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+/*
+ * Fast tanh approximation, used to saturate the ladder feedback
+ * The rational curve reaches -1.0 and 1.0 at -3.0 and 3.0 and is clipped past them,
+ * the error is below 0.025
+ */
+float fast_tanh(float x);
+
+/*
+ * Returns the coefficient of a filter type for a cutoff between 0.0 and 1.0 at the sample rate
+ * The one-pole and ladder filters use the one-pole low-pass coefficient,
+ * the state-variable filter uses the gain of its integrators
+ */
+float filter_coefficient(int type, float cutoff, int rate);
+
+/* Returns the damping of the state-variable filter for a resonance between 0.0 and 1.0 */
+float svf_damping(float resonance);
+
+/* Returns the feedback of the ladder filter for a resonance between 0.0 and 1.0 */
+float ladder_feedback(float resonance);
+
+/*
+ * Set the weights of the input, band-pass and low-pass outputs
+ * of the state-variable filter that make the output of a mode
+ */
+void svf_mode_mix(int mode, float damping, float mix[3]);
+
+/*
+ * Process a buffer in place with a 2-pole state-variable filter in the given mode
+ * The state holds the 2 integrators, the gain ramps linearly from from to to
+ */
+void svf_process_block(float *state, int mode, float *buffer,
+                       float from, float to, float damping, int nframes);
+
+/*
+ * Process a buffer in place with a 4-pole ladder filter
+ * The state holds the output of the 4 stages, the coefficient ramps linearly
+ * from from to to, the feedback of the last stage is saturated
+ */
+void ladder_process_block(float *state, float *buffer,
+                          float from, float to, float feedback, int nframes);
+
+#endif
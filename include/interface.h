@@ -4,42 +4,44 @@
 #include <libxml2/libxml/parser.h>
 
 #include "synth.h"
+#include "control.h"
 
 /* Render the ADSR envelope sliders */
 void render_adsr(
     float *attack, float *decay, 
-    float *sustain, float *release);
+    float *sustain, float *release,
+    bool *exponential);
 
 /* Render the filter ADSR envelope sliders */
-void render_filter_adsr(synth_t *synth);
+void render_filter_adsr(synth_params_t *params);
 
 /* Render the filter ADSR envelope sliders */
-void render_filter_adsr(synth_t *synth);
+void render_filter_adsr(synth_params_t *params);
 
 /* Render the oscillators waveforms dropdown menus*/
 void render_osc_waveforms(
     int *wave_a, int *wave_b, int *wave_c, 
     bool *ddm_a, bool *ddm_b, bool *ddm_c);
 
-/* Render the synthesizer parameters */
-void render_synth_params(synth_t *synth);
+/* Render the synthesizer parameters, with the filter type dropdown menu */
+void render_synth_params(
+    synth_params_t *params, const synth_display_t *display,
+    bool *filter_ddm);
 
 /* Render the options menu */
 void render_options(
-    synth_t *synth,
+    control_t *control, synth_params_t *params,
     char *audio_filename,
     bool *saving_preset, bool *loading_preset,
     bool *saving_audio_file, bool *recording);
 
 /* Render the effects parameters */
 void render_effects(
-    synth_t *synth, 
-    bool *lfo_wave_ddm, bool *lfo_params_ddm,
-    bool *distortion, bool *overdrive,
-    float *distortion_amount);
+    synth_params_t *params, 
+    bool *lfo_wave_ddm, bool *lfo_params_ddm);
 
 /* Renders the waveform generated by the render_synth function */
-void render_waveform(short *buffer);
+void render_waveform(const short *buffer);
 
 /* Render the white keys from the MIDI piano visualizer */
 void render_white_keys();
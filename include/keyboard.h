@@ -1,22 +1,22 @@
 #ifndef KEYBOARD_H
 #define KEYBOARD_H
 
-#include "synth.h"
+#include "control.h"
 
 /*
  * Get the keyboard input from the SDL key event and the keyboard layout (QWERTY or AZERTY)
- * Change the synth_t voices frequencies with the assigned note
+ * Send the assigned notes to the audio thread
  * Change the keyboard octave when UP or DOWN keys are being pressed
  */
-void handle_input(synth_t *synth, int *octave);
+void handle_input(control_t *control, int *octave);
 
 /* Free the synth voices when their assigned note key are being released */
-void handle_release(synth_t *synth, int octave);
+void handle_release(control_t *control, int octave);
 
-/* Assign a note to a free synth voice */
-void assign_note(synth_t *synth, int midi_note);
+/* Send a note on to the audio thread, which assigns it to a free synth voice */
+void assign_note(control_t *control, int midi_note);
 
-/* Release a note from a synth voice, does nothing if note is not pressed */
-void release_note(synth_t *synth, int midi_note);
+/* Send a note off to the audio thread, does nothing there if the note isn't pressed */
+void release_note(control_t *control, int midi_note);
 
 #endif
\ No newline at end of file
@@ -1,17 +1,49 @@
 #ifndef MIDI_H
 #define MIDI_H
 
+#include <pthread.h>
+#include <poll.h>
+#include <stdatomic.h>
 #include <alsa/asoundlib.h>
-#include "synth.h"
+
+#include "defs.h"
+#include "control.h"
+
+/*
+ * MIDI input structure
+ * The MIDI thread waits on the poll descriptors of the ALSA RawMIDI input,
+ * and sends the pressed and released notes to the audio thread as soon as they arrive
+ * The knobs and the pitch wheel change the parameters owned by the GUI thread,
+ * their last values are kept in the atomics until the GUI thread applies them,
+ * -1 if they didn't change since
+ */
+typedef struct
+{
+    snd_rawmidi_t *in;
+    control_t *control;
+    struct pollfd fds[MIDI_POLL_FDS];
+    int nfds;
+    atomic_int knobs[MIDI_CONTROLLERS];
+    atomic_int pitch_bend;
+    pthread_t thread;
+    atomic_bool running;
+} midi_t;
+
+/*
+ * Start the MIDI thread reading the ALSA RawMIDI input (snd_rawmidi_t)
+ * Returns 1 if the poll descriptors can't be read or the thread couldn't be created
+ */
+int midi_start(midi_t *midi, snd_rawmidi_t *in, control_t *control);
+
+/* Stop the MIDI thread and wait for it to finish */
+void midi_stop(midi_t *midi);
 
 /*
- * Get the MIDI input from the ALSA RawMIDI input (snd_rawmidi_t)
- * Activate the synth voices and update their frequencies with the given note
- * Turn off the synth voices when their assigned note are being released
- * Change the ADSR parameters when the assigned knobs are being triggered
- * Change the cutoff, detune and amplification when the assigned knobs are being triggered
+ * Apply the knobs and the pitch wheel moved since the last call to the parameters :
+ * - ADSR parameters
+ * - Cutoff, detune and amplification
+ * - Pitch bend
  */
-int get_midi(snd_rawmidi_t *midi_in, synth_t *synth,
-             float *attack, float *decay, float *sustain, float *release);
+void midi_apply(midi_t *midi, synth_params_t *params);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,23 @@
+#ifndef PITCH_H
+#define PITCH_H
+
+/* Build the frequency table of the MIDI notes, called once at startup */
+void pitch_init(void);
+
+/*
+ * Returns the frequency of a MIDI note (0 to 127) from the table
+ * The notes outside the MIDI range are clamped to it
+ */
+float note_freq(int note);
+
+/*
+ * Fast 2^x approximation, for the continuous pitch modulations
+ * The relative error is below 3e-6, about 0.005 cent
+ * x must be between -126 and 127
+ */
+float fast_exp2(float x);
+
+/* Returns the frequency ratio of an interval in cents */
+float cents_ratio(float cents);
+
+#endif
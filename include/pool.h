@@ -0,0 +1,61 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "defs.h"
+
+/* Job run by the pool, called once for each job index of a batch */
+typedef void (*pool_job_t)(void *arg, int job);
+
+/* Argument of a worker thread, its pool and its wake semaphore index */
+typedef struct
+{
+    struct pool *pool;
+    int index;
+} pool_worker_t;
+
+/*
+ * Worker threads pool running batches of jobs for the audio thread
+ * The workers sleep on their semaphore until a batch is posted
+ * The claim word packs the number of jobs of the batch (high 16 bits)
+ * and the next job to claim (low 16 bits), so that a worker waking late
+ * can never take a job of a batch it wasn't posted for
+ * The caller renders jobs too, then sleeps on the finished semaphore,
+ * posted once per batch by whoever completes its last job, so that a worker
+ * still running a job is never starved by a caller spinning on its core
+ */
+typedef struct pool
+{
+    int count;
+    pthread_t threads[POOL_MAX_THREADS];
+    pool_worker_t workers[POOL_MAX_THREADS];
+    sem_t wake[POOL_MAX_THREADS];
+    sem_t finished;
+    atomic_bool running;
+    atomic_uint claim;
+    atomic_int done;
+    pool_job_t job;
+    void *arg;
+} pool_t;
+
+/*
+ * Start a pool of worker threads
+ * Returns 1 if a thread couldn't be created
+ */
+int pool_init(pool_t *pool, int count);
+
+/* Stop the worker threads and wait for them to finish */
+void pool_free(pool_t *pool);
+
+/*
+ * Run a batch of jobs and wait for all of them to be done
+ * Never allocates nor locks, the jobs run in the caller if the pool is NULL
+ * The caller claims the jobs left, then sleeps until the running ones are done
+ */
+void pool_run(pool_t *pool, int jobs, pool_job_t job, void *arg);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <pthread.h>
+
+/*
+ * Create a thread with a stack of REALTIME_THREAD_STACK bytes
+ * Returns the pthread_create error, 0 if the thread was created
+ */
+int realtime_create(pthread_t *thread, void *(*routine)(void *), void *arg);
+
+/*
+ * Move a thread to the SCHED_FIFO real-time scheduling with the given priority,
+ * if priority isn't 0, and pin it on the given CPU core, if cpu isn't -1
+ * Prints why if the permissions are missing
+ * Returns 1 if one of them couldn't be applied, the thread then keeps running without it
+ */
+int realtime_thread(pthread_t thread, int priority, int cpu);
+
+/*
+ * Lock the current and future memory of the process in RAM, so that it never pages out
+ * Prints why if the permissions or the memlock limit are missing
+ * Returns 1 if the memory couldn't be locked
+ */
+int realtime_lock_memory(void);
+
+/* Touch the stack the calling thread may use, so that it doesn't page fault on it later */
+void realtime_prefault_stack(void);
+
+#endif
@@ -2,6 +2,9 @@
 #define RECORD_H
 
 #include <stdio.h>
+#include <stdatomic.h>
+
+#include "defs.h"
 
 /* Wav header structure */
 typedef struct 
@@ -21,8 +24,19 @@ typedef struct
     unsigned int sub2_size;
 } wav_header_t;
 
-/* Initialize wav header */
-int init_wav_header(wav_header_t *header);
+/*
+ * Single producer, single consumer ring buffer of recorded samples
+ * The audio thread pushes the rendered blocks, the GUI thread pops them into the WAV file
+ * The head is only written by the producer and the tail only by the consumer
+ */
+typedef struct
+{
+    short data[RECORD_RING_SIZE];
+    atomic_uint head, tail;
+} record_ring_t;
+
+/* Initialize wav header for mono 16 bits samples at the sample rate */
+int init_wav_header(wav_header_t *header, int rate);
 
 /* Initialize a wav file with a filename and wav header */
 int init_wav_file(char *fname, FILE **fwav, wav_header_t *header);
@@ -30,4 +44,16 @@ int init_wav_file(char *fname, FILE **fwav, wav_header_t *header);
 /* Close a wav file */
 int close_wav_file(FILE *fwav);
 
+/*
+ * Push samples into the record ring buffer, never blocks
+ * Returns the number of samples pushed, lower than count if the ring is full
+ */
+unsigned int record_ring_push(record_ring_t *ring, const short *samples, unsigned int count);
+
+/*
+ * Pop up to count samples from the record ring buffer
+ * Returns the number of samples popped
+ */
+unsigned int record_ring_pop(record_ring_t *ring, short *samples, unsigned int count);
+
 #endif 
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef RTLOG_H
+#define RTLOG_H
+
+#include <stdio.h>
+
+/*
+ * Real-time safe logging
+ * The audio and MIDI paths push fixed-size messages into a lock-free ring buffer,
+ * a background thread formats them and writes them into the log stream
+ * A message is a printf format and up to RTLOG_ARGS arguments, the d, i, u, x, c
+ * conversions (with an optional l), the f, e, g conversions and the s one are supported
+ * The format and the strings must outlive the message, like string literals,
+ * the error strings of strerror and snd_strerror may not, the error codes are logged instead
+ */
+
+/*
+ * Start the logging thread, writing the messages into the stream
+ * Returns 1 if the thread couldn't be created
+ */
+int rtlog_init(FILE *stream);
+
+/*
+ * Stop the logging thread, after it wrote the pending messages
+ * The messages pushed after its last pass are written here,
+ * the ones still being written by their thread are counted as dropped
+ */
+void rtlog_free(void);
+
+/*
+ * Push a message from any thread, never blocks, locks nor allocates
+ * The message is dropped and counted if the ring buffer is full or the thread isn't running
+ * Returns 1 if the message was dropped
+ */
+int rtlog(const char *format, ...);
+
+/* Returns the number of messages dropped since the start */
+unsigned int rtlog_dropped(void);
+
+#endif
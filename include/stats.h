@@ -0,0 +1,51 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "defs.h"
+
+/*
+ * Histogram of positive values, written by a single thread and read by any other
+ * The values under STATS_SUB_BUCKETS have their own bucket, the higher ones are
+ * spread over STATS_SUB_BUCKETS buckets per power of two, so a percentile read
+ * from the histogram is within 1 / STATS_SUB_BUCKETS of the real value
+ * The maximum is exact
+ */
+typedef struct
+{
+    atomic_uint counts[STATS_BUCKETS];
+    atomic_uint total, max;
+} stats_histogram_t;
+
+/*
+ * Timing statistics of the audio thread, updated without locks
+ * The render histogram holds the time to render each period in microseconds,
+ * the load histogram the same time relative to the period duration, in hundredths of percent
+ * The delay histogram holds the sound card delay after each period in microseconds,
+ * the time a rendered sample waits before being played
+ */
+typedef struct
+{
+    atomic_uint periods, xruns, errors;
+    stats_histogram_t render, load, delay;
+} audio_stats_t;
+
+/* Add a value to a histogram, never blocks */
+void stats_add(stats_histogram_t *histogram, unsigned int value);
+
+/* Returns the value under which the given ratio (0.0 to 1.0) of the histogram values are */
+unsigned int stats_percentile(const stats_histogram_t *histogram, double ratio);
+
+/* Returns the microseconds elapsed since start on the monotonic clock */
+unsigned int stats_elapsed_us(const struct timespec *start);
+
+/*
+ * Write the counters and the p50, p99 and max of the histograms into a file
+ * Returns 1 if the file couldn't be written
+ */
+int stats_dump(const audio_stats_t *stats, const char *fname);
+
+#endif
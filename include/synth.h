@@ -3,6 +3,10 @@
 
 #include <stdbool.h>
 
+#include "defs.h"
+#include "wavetable.h"
+#include "pool.h"
+
 /* ADSR envelope states */
 typedef enum
 {
@@ -10,133 +14,357 @@ typedef enum
     ENV_ATTACK,
     ENV_DECAY,
     ENV_SUSTAIN,
-    ENV_RELEASE
+    ENV_RELEASE,
+    ENV_FADE
 } env_state_t;
 
 /*
- * Time-based ADSR envelope structure
- * Each parameter is expressed in seconds
- * The sustain parameter controls the sound level
+ * Time-based ADSR envelope state
+ * The parameters of the envelope are in the synth parameters
  * The output is the amplification coefficient of the envelope
  */
 typedef struct
 {
-    float *attack, *decay, *sustain, *release;
     float output;
     env_state_t state;
 } adsr_t;
 
 /*
- * Oscillator structure
- * Wave can either be a sine, square, triangle or sawtooth
+ * Envelope segment, moving the output by output * mul + add at each sample
+ * The segment ends when the output crosses the level in the direction of the sign,
+ * the output is then set to end and the envelope goes in the next state
  */
 typedef struct
 {
-    float freq, phase;
-    int *wave;
-} osc_t;
+    float mul, add;
+    float level, sign, end;
+    env_state_t next;
+} adsr_segment_t;
 
+/*
+ * ADSR envelope coefficients, computed from the parameters at each block
+ * so that the voices never divide by the stage times
+ * The segments are indexed by the envelope state, the sustain state has none
+ */
+typedef struct
+{
+    adsr_segment_t segments[ENV_FADE + 1];
+    float sustain;
+} adsr_coefs_t;
+
+/*
+ * LFO oscillator state, its waveform and frequency are in the synth parameters
+ * The value is the LFO output at the last control tick
+ */
 typedef struct 
 {
-    osc_t *osc;
-    int mod_param;
+    float phase, value;
 } lfo_t;
 
-/* Low-pass filter structure */
+/*
+ * Filter structure, for the one-pole low-pass filter and the resonant filters
+ * The alpha coefficient is the one applied at the last processed sample
+ * The target coefficient is cached for the last requested cutoff,
+ * so that it is only recomputed when the cutoff changes
+ * The state holds the integrators or stages of the resonant filter of the type
+ * The coefficients are computed for the sample rate
+ */
 typedef struct
 {
-    float prev_input, prev_output, cutoff, env_cutoff, lfo_cutoff;
-    adsr_t *adsr;
-    bool env;
+    float prev_input, prev_output, env_cutoff, lfo_cutoff;
+    float alpha, cutoff, target;
+    float state[FILTER_STAGES];
+    int type;
+    int rate;
+    adsr_t adsr;
 } lp_filter_t;
 
 /*
- * 3 oscillators voice structure
- * Each voice has its own ADSR envelope and MIDI velocity amplification
- * The note is in MIDI range (0 to 127)
+ * Parameters of the synth, edited by the GUI and the MIDI knobs
+ * The audio thread reads them from a snapshot taken at each block,
+ * so that a set of parameters is always applied whole
+ * The ADSR envelopes parameters are expressed in seconds, except the sustain levels,
+ * their segments are exponential when exp_env is set, linear otherwise
+ * Cutoff, detune, amplification, LFO frequency and distortion amount are between 0.0 and 1.0
+ * When voice_filters is set, each voice has its own filter and filter envelope
+ * instead of the filter of the mix
+ * The filter type is one of the filter types, the resonance is between 0.0 and 1.0
+ * The waveforms can either be a sine, square, triangle or sawtooth
+ * The pitch bend is between -1.0 and 1.0 of the PITCH_BEND_RANGE,
+ * the glide is the time to slide from the last played note, 0.0 to turn it off
+ */
+typedef struct
+{
+    float attack, decay, sustain, release;
+    float filter_attack, filter_decay, filter_sustain, filter_release;
+    bool exp_env;
+    float cutoff;
+    bool filter_env, voice_filters;
+    int filter_type;
+    float resonance;
+    int waves[3];
+    float detune, amp;
+    float pitch_bend, glide;
+    int lfo_wave, lfo_param;
+    float lfo_freq;
+    bool arp;
+    float bpm;
+    bool distortion, overdrive;
+    float distortion_amount;
+} synth_params_t;
+
+/*
+ * Doubly linked list of voices indices, -1 terminated
+ * A voice is in the list if it is the head or has a previous voice
  */
 typedef struct
 {
-    osc_t *oscillators;
-    adsr_t *adsr;
-    int pressed;
-    int note;
-    double velocity_amp;
-} voice_t;
-
-/*
- * Polyphonic synthesizer structure
- * Voices is an array of voice_t
- * Detune is between 0.0 and 1.0
- * Amplification is between 0.0 and 1.0
+    int head, tail;
+    int *prev, *next;
+} voice_list_t;
+
+/*
+ * 3 oscillators voices pool, stored as a structure of arrays
+ * Every array lives in a single cache-line aligned allocation
+ * The oscillators arrays are indexed by oscillator * stride + voice,
+ * so each oscillator of every voice is contiguous in memory
+ * The notes are in MIDI range (0 to 127), -1 when the voice is free
+ * The pitch is the MIDI pitch played by the voice, fractional while it
+ * glides to its target pitch by glide_rate semitones per sample
+ * The filter arrays are the state of the per-voice filters and filter envelopes,
+ * the filter state being indexed by stage * stride + voice
+ * The filter type is the one the filter states were built with
+ * The active list holds the voices that may be sounding, every voice
+ * that isn't idle is in it, the idle ones are removed by voices_compact
+ * The active_index array is the position of each voice in the list, -1 if absent
+ * The free list holds the idle voices that aren't pressed, oldest first
+ * The busy list holds the other voices, in the order they were pressed,
+ * the released list holds the busy voices still sounding after their note off
+ * The note_voice map gives the voice pressing each MIDI note, -1 if none
+ * The held array holds the pressed voices sorted by note, for the arpeggiator
+ * When no voice is free, one is stolen with the steal policy and faded out
+ * in one of the STEAL_FADE_VOICES spare voices following the pool
+ * The quietest voice is found at each block, for the quietest steal policy
+ */
+typedef struct
+{
+    int count, stride;
+    float *phase, *phase_inc, *freq;
+    float *env_output;
+    env_state_t *env_state;
+    float *velocity_amp;
+    float *pitch, *pitch_target, *glide_rate;
+    float *filter_state, *filter_alpha, *filter_env_output;
+    env_state_t *filter_env_state;
+    int filter_type;
+    int *note;
+    int *pressed;
+    int *active, *active_index;
+    int active_count;
+    voice_list_t free, busy, released;
+    int note_voice[MIDI_NOTES];
+    int *held;
+    int pressed_count;
+    int quietest;
+    int steal_policy;
+    void *memory;
+} voices_t;
+
+/*
+ * Polyphonic synthesizer structure, owned by the audio thread
+ * Voices is the voices pool
+ * The params are the snapshot of the parameters used by the current block
+ * The detune and the pitch bend are the ones applied to the voices oscillators,
+ * they follow the parameters at each block, the bend being the pitch bend ratio
+ * The last pitch is the pitch of the last played note, where the glides start from,
+ * gliding is the number of voices still gliding
  * The LFO variables are used when the LFO is modulating the base variable
- * The active_arp variable is the index of the current active voice from the arpeggio
+ * The active_arp variable is the index of the current arpeggio note in the held voices
  * The active_arp_float is a number between 0 and 1 
  * used to move from beat to beat on the arpeggio
+ * The oscillators are computed when the wavetables are NULL
+ * The voices are rendered by the worker pool, on the audio thread only if it is NULL
+ * The rate is the sample rate of the output, in Hz
+ * The modulations are evaluated every control_rate samples
+ * The envelope and filter_envelope coefficients follow the parameters at each block
  */
 typedef struct
 {
-    voice_t *voices;
+    voices_t *voices;
+    wavetables_t *wavetables;
+    pool_t *pool;
+    const synth_params_t *params;
     lp_filter_t *filter;
     lfo_t *lfo;
     float detune;
+    float pitch_bend, bend;
+    float last_pitch;
+    int gliding;
     float lfo_detune;
-    float amp;
     float lfo_amp;
     int active_arp;
-    float bpm;
     float active_arp_float;
-    bool arp;
+    int rate;
+    int control_rate;
+    adsr_coefs_t envelope, filter_envelope;
 } synth_t;
 
 /*
- * Process a sample from the ADSR envelope
- * Returns the envelope amplification coeficient
+ * Compute the envelope coefficients of the given ADSR parameters at the sample rate
+ * The segments are exponential if exponential is true, else linear
+ */
+void adsr_coefs_init(adsr_coefs_t *coefs,
+                     float attack, float decay,
+                     float sustain, float release,
+                     bool exponential, int rate);
+
+/*
+ * Process nframes samples from an envelope state with the given coefficients
+ * The amplification coefficients are written every stride floats of the buffer
+ * Returns the envelope amplification coeficient of the last sample
+ */
+float adsr_block(env_state_t *state, float *output,
+                 const adsr_coefs_t *coefs,
+                 float *buffer, int stride, int nframes);
+
+/*
+ * Allocate the voices pool arrays in a single aligned allocation
+ * Returns 1 if the allocation failed
+ */
+int voices_init(voices_t *voices, int count);
+
+/* Free the voices pool arrays */
+void voices_free(voices_t *voices);
+
+/* Release all of the voices at once, cutting their sound */
+void voices_reset(voices_t *voices);
+
+/*
+ * Start the envelopes of a voice and add it to the active list
+ * The filter of the voice starts closed and empty
+ */
+void voice_start(voices_t *voices, int voice);
+
+/*
+ * Remove the idle voices from the active list, keeping the order of the others
+ * The idle voices that aren't pressed anymore go back to the free list
+ * Also finds the quietest sounding voice, for the voice stealing
+ */
+void voices_compact(voices_t *voices);
+
+/*
+ * Press a note on the voice already holding it, else on the next free voice
+ * If no voice is free, one is stolen with the steal policy
+ * Returns the index of the voice, -1 if none could be found
+ */
+int voice_press(voices_t *voices, int note);
+
+/*
+ * Release the voice holding a note
+ * The voice goes back to the free list once it is idle
+ * Returns the index of the voice, -1 if the note isn't pressed
+ */
+int voice_release(voices_t *voices, int note);
+
+/*
+ * Press a note on a voice and start it with the given MIDI velocity
+ * Restarts the filter envelope and the arpeggio on the first pressed note
+ * Notes outside the MIDI range (0 to 127) are ignored
+ */
+void synth_note_on(synth_t *synth, int note, int velocity);
+
+/*
+ * Release the voice holding a note, does nothing if the note isn't pressed
+ * or is outside the MIDI range
+ * The voice is cut when the arpeggiator is on, else it goes in release
  */
-float adsr_process(adsr_t *adsr);
+void synth_note_off(synth_t *synth, int note);
 
-/* Process the synth voices into the sound buffer */
-double process_voices(synth_t *synth);
+/*
+ * Process the synth voices into the sound buffer
+ * The buffer is overwritten with the mix of the active voices
+ * The lfo buffer holds the LFO automation computed by process_lfo
+ */
+void process_voices(synth_t *synth, float *buffer,
+                    const float *lfo, int nframes);
 
-/* Process the LFO modulation */
-void process_lfo(synth_t *synth);
+/*
+ * Process the LFO modulation
+ * The LFO is evaluated once per control tick, in between
+ * the lfo buffer holds a linear ramp from one tick to the next
+ */
+void process_lfo(synth_t *synth, float *lfo, int nframes);
 
-/* Process the gain on a sample */
-double process_gain(synth_t synth, double sample, int active_voices);
+/* Process the gain onto the sound buffer */
+void process_gain(synth_t *synth, float *buffer,
+                  int nframes, int active_voices);
 
-/* Process the low-pass filter on a sample */
-double process_filter(synth_t *synth, double sample);
+/*
+ * Process the low-pass filter onto the sound buffer
+ * The cutoff modulations are evaluated once per control tick
+ * and the filter coefficient ramps linearly in between
+ */
+void process_filter(synth_t *synth, float *buffer,
+                    const float *lfo, int nframes);
 
-/* Process the arpeggiator */
-void process_arpeggiator(synth_t *synth, int active_voices);
+/*
+ * Advance the arpeggiator clock by up to nframes samples
+ * Returns the number of samples until the next arpeggio step included,
+ * or nframes if the step doesn't happen in this block
+ */
+int process_arpeggiator(synth_t *synth, int nframes);
+
+/* Returns the voice of the held note played by the arpeggiator, -1 if none */
+int arpeggiator_voice(synth_t *synth);
+
+/* Move the arpeggiator to its next held note */
+void arpeggiator_step(synth_t *synth);
+
+/*
+ * Render a block of samples from the synth into the output buffer
+ * The parameters are read from synth->params, which must be set
+ * The block is cut at the arpeggio steps so that every stage
+ * processes a run of samples with the same active voices
+ */
+void synth_render(synth_t *synth, float *out, int nframes);
 
 /*
- * Change the frequency of a voice_t oscillators with the given MIDI note and velocity
- * Multiplied by the synth_t detune coefficient
+ * Change the frequency of a voice oscillators with the given MIDI note and velocity
+ * The note glides from the last played note when the glide is on
+ * The oscillators B and C are detuned by the synth_t detune in cents
  */
-void change_freq(voice_t *voice, int note,
-                 int velocity, double detune);
+void change_freq(synth_t *synth, int voice, int note, int velocity);
 
-/* Apply the detune change to the voices oscillators */
+/* Apply the detune and pitch bend changes to the voices oscillators */
 void apply_detune_change(synth_t *synth);
 
 /* Get the literal name of a given waveform */
 const char *get_wave_name(int wave);
 
+/* Returns the low-pass filter coefficient of a cutoff between 0.0 and 1.0 at the sample rate */
+float lp_alpha(float cutoff, int rate);
+
 /*
  * Process a sample with the low-pass filter and the given cutoff
  * Returns the processed sample
  */
-double lp_process(lp_filter_t *filter, double input,
-                float cutoff);
+float lp_process(lp_filter_t *filter, float input,
+                 float cutoff);
 
 /*
- * Returns the first free voice from the synth_t
- * Used to assign a note send by MIDI or keyboard to the first free voice
+ * Process a buffer in place with the low-pass filter and the given cutoff
+ * The coefficient ramps linearly from the current one to the one of the cutoff,
+ * it stays constant when the cutoff didn't change
  */
-voice_t *get_free_voice(synth_t *synth);
+void lp_process_block(lp_filter_t *filter, float *buffer,
+                      float cutoff, int nframes);
 
-/* Insertion sort algorithm for the voices of a synth_t, used for the arpeggiator */
-void sort_synth_voices(synth_t *synth);
+/*
+ * Process a buffer in place with the filter of the given type, cutoff and resonance
+ * The filter is emptied when its type changes, the coefficient then starts
+ * from the one of the new type
+ */
+void filter_process_block(lp_filter_t *filter, float *buffer, int type,
+                          float cutoff, float resonance, int nframes);
 
 #endif
\ No newline at end of file
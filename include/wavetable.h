@@ -0,0 +1,38 @@
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+
+/*
+ * Oscillators wavetables structure
+ * Built once at startup and shared read-only by every voice
+ * The sine has a single table, the other waveforms have one band-limited
+ * table per octave (mip-map levels), level l holding only the harmonics
+ * that stay under the Nyquist frequency up to WAVETABLE_BASE_FREQ * 2^l
+ * The levels of a waveform follow each other, stride samples apart
+ * The size is a power of two, each table has an extra guard sample
+ * equal to its first one so the interpolation never wraps
+ */
+typedef struct
+{
+    int size, stride;
+    int levels[4];
+    float *tables[4];
+    void *memory;
+} wavetables_t;
+
+/*
+ * Build the wavetables of every waveform with the given size,
+ * band-limited for the sample rate
+ * Returns 1 if the size is not a power of two or if the allocation failed
+ */
+int wavetables_init(wavetables_t *wavetables, int size, int rate);
+
+/* Free the wavetables */
+void wavetables_free(wavetables_t *wavetables);
+
+/* Returns the mip-map level of a waveform to use for the given frequency */
+int wavetable_level(const wavetables_t *wavetables, int wave, float freq);
+
+/* Read the first level of a waveform at a phase between 0 and 1, with linear interpolation */
+float wavetable_lookup(const wavetables_t *wavetables, int wave, float phase);
+
+#endif
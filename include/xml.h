@@ -16,13 +16,8 @@
  * - Amplification
  */
 int save_preset(
-    synth_t synth,
-    float attack, float decay,
-    float sustain, float release,
-    int wave_a, int wave_b, int wave_c,
-    char *preset_filename, bool *saving_preset,
-    bool distortion, bool overdrive, 
-    float distortion_amount);
+    const synth_params_t *params,
+    char *preset_filename, bool *saving_preset);
 
 /*
  * Load a preset from an XML file to the application :
@@ -34,34 +29,30 @@ int save_preset(
  * - Amplification
  */
 int load_preset(
-    synth_t *synth,
-    float *attack, float *decay,
-    float *sustain, float *release,
-    int *wave_a, int *wave_b, int *wave_c, 
-    bool *distortion, bool *overdrive, 
-    float *distortion_amount,
+    synth_params_t *params,
     bool *loading_preset);
 
 int parse_filter(xmlNode *filter_node, 
-                synth_t *synth);
+                synth_params_t *params);
 
-int parse_effects(xmlNode *effects_node, synth_t *synth,
-        bool *distortion, bool *overdrive, float *distortion_amount);
+int parse_effects(xmlNode *effects_node, synth_params_t *params);
 
 int parse_oscillators(xmlNode *osc_node, 
     int *wave_a, int *wave_b, int *wave_c);
 
-int parse_lfo(xmlNode *lfo_node, synth_t *synth);
+int parse_lfo(xmlNode *lfo_node, synth_params_t *params);
 
 int parse_distortion(xmlNode *distortion_node, 
     bool *distortion, bool *overdrive, float *distortion_amount);
 
-/* Parse an ADSR XML Node whether it's basic ADSR of filter ADSR */
+/*
+ * Parse an ADSR XML Node whether it's basic ADSR of filter ADSR
+ * The exponential segments ON/OFF is only read if exponential isn't NULL
+ */
 int parse_adsr(
     xmlNode *adsr_root_node,
-    synth_t *synth,
     float *attack, float *decay,
     float *sustain, float *release,
-    bool filter);
+    bool *exponential);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,450 @@
+#include <alsa/asoundlib.h>
+
+#include "defs.h"
+#include "audio.h"
+#include "synth.h"
+#include "effects.h"
+#include "record.h"
+#include "control.h"
+#include "dsp.h"
+#include "realtime.h"
+#include "stats.h"
+#include "rtlog.h"
+
+/*
+ * Take the newest parameters and apply the pending note events to the synth
+ * Called at the start of each block, so that a block never sees a half-updated set
+ */
+static void update_synth(audio_t *audio)
+{
+    synth_t *synth = audio->synth;
+    synth_event_t event;
+
+    synth->params = control_acquire_params(audio->control);
+
+    while (control_pop_event(audio->control, &event))
+    {
+        switch (event.type)
+        {
+        case EVENT_NOTE_ON:
+            synth_note_on(synth, event.note, event.velocity);
+            break;
+        case EVENT_NOTE_OFF:
+            synth_note_off(synth, event.note);
+            break;
+        case EVENT_RESET:
+            voices_reset(synth->voices);
+            break;
+        }
+    }
+}
+
+/* Render a block of nframes samples from the synth into the buffer */
+static void render_block(audio_t *audio, short *buffer, int nframes)
+{
+    const synth_params_t *params = audio->synth->params;
+    float samples[FRAMES];
+
+    synth_render(audio->synth, samples, nframes);
+    dsp_to_s16(samples, buffer, nframes);
+
+    if (params->distortion)
+    {
+        distortion(buffer, nframes, params->distortion_amount, params->overdrive);
+    }
+}
+
+/* Publish the state of the synth after the rendered block to the GUI thread */
+static void publish_display(audio_t *audio, const short *buffer, int nframes)
+{
+    synth_t *synth = audio->synth;
+    voices_t *voices = synth->voices;
+    synth_display_t *display = control_display_slot(audio->control);
+
+    /* Scrolling the scope by the block */
+    int kept = FRAMES - nframes;
+    memmove(audio->scope, audio->scope + nframes, sizeof(short) * kept);
+    memcpy(audio->scope + kept, buffer, sizeof(short) * nframes);
+    memcpy(display->scope, audio->scope, sizeof(display->scope));
+    display->lfo_amp = synth->lfo_amp;
+    display->lfo_detune = synth->lfo_detune;
+    display->lfo_cutoff = synth->filter->lfo_cutoff;
+
+    for (int n = 0; n < MIDI_NOTES; n++)
+    {
+        display->pressed[n] = voices->note_voice[n] != -1;
+    }
+
+    int arp_voice = arpeggiator_voice(synth);
+    display->arp_note = (synth->params->arp && arp_voice != -1) ? voices->note[arp_voice] : -1;
+
+    control_publish_display(audio->control);
+}
+
+/* Render a block into the buffer, show it in the GUI and record it */
+static void play_block(audio_t *audio, short *buffer, int nframes)
+{
+    render_block(audio, buffer, nframes);
+    publish_display(audio, buffer, nframes);
+
+    if (atomic_load(&audio->recording))
+    {
+        unsigned int pushed = record_ring_push(audio->record, buffer, nframes);
+        if (pushed < (unsigned int)nframes)
+        {
+            rtlog("recording buffer full, %d samples dropped\n", nframes - (int)pushed);
+        }
+    }
+}
+
+/* Prepare the sound card again after an underrun or a write error */
+static void recover(audio_t *audio, int err)
+{
+    if (err == -EPIPE)
+    {
+        atomic_fetch_add_explicit(&audio->stats.xruns, 1, memory_order_relaxed);
+        rtlog("ALSA underrun!\n");
+    }
+    else
+    {
+        atomic_fetch_add_explicit(&audio->stats.errors, 1, memory_order_relaxed);
+        rtlog("ALSA write error: %d\n", err);
+    }
+    snd_pcm_prepare(audio->handle);
+}
+
+/*
+ * Record the time spent rendering a period since start,
+ * and the load it puts on the audio thread relative to the period duration
+ */
+static void record_render_time(audio_t *audio, const struct timespec *start)
+{
+    audio_stats_t *stats = &audio->stats;
+    unsigned int render = stats_elapsed_us(start);
+
+    stats_add(&stats->render, render);
+    stats_add(&stats->load, (unsigned long long)render * audio->rate / (100ULL * audio->period));
+    atomic_fetch_add_explicit(&stats->periods, 1, memory_order_relaxed);
+}
+
+/* Record the time the last written sample waits before being played */
+static void record_delay(audio_t *audio)
+{
+    snd_pcm_sframes_t delay;
+    if (snd_pcm_delay(audio->handle, &delay) == 0 && delay >= 0)
+    {
+        stats_add(&audio->stats.delay, (unsigned long long)delay * 1000000 / audio->rate);
+    }
+}
+
+/*
+ * Wait until a period of the sound card buffer is free, on its poll descriptors
+ * The sound card is started once its buffer is full
+ * Returns the free frames, lower than a period if the thread is stopping,
+ * or a negative error on an underrun
+ */
+static snd_pcm_sframes_t wait_period(audio_t *audio)
+{
+    snd_pcm_t *handle = audio->handle;
+
+    for (;;)
+    {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+        if (avail < 0 || avail >= audio->period || !atomic_load(&audio->running))
+        {
+            return avail;
+        }
+
+        if (snd_pcm_state(handle) == SND_PCM_STATE_PREPARED)
+        {
+            snd_pcm_start(handle);
+        }
+
+        if (poll(audio->fds, audio->nfds, AUDIO_POLL_TIMEOUT) < 0 && errno != EINTR)
+        {
+            return -errno;
+        }
+
+        /* The plugins may turn the descriptors events into other ones */
+        unsigned short revents;
+        snd_pcm_poll_descriptors_revents(handle, audio->fds, audio->nfds, &revents);
+    }
+}
+
+/*
+ * Render a period into a buffer, then write it to the sound card
+ * The write never blocks, the wait for a free period paces the thread
+ */
+static void write_period(audio_t *audio)
+{
+    short buffer[FRAMES];
+
+    snd_pcm_sframes_t avail = wait_period(audio);
+    if (avail < 0)
+    {
+        recover(audio, avail);
+        return;
+    }
+    if (avail < audio->period)
+    {
+        return;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    play_block(audio, buffer, audio->period);
+    record_render_time(audio, &start);
+
+    int err = snd_pcm_writei(audio->handle, buffer, audio->period);
+    if (err < 0)
+    {
+        recover(audio, err);
+        return;
+    }
+    record_delay(audio);
+}
+
+/*
+ * Render a period straight into the sound card buffer, without any copy
+ * The period is split in two blocks when it wraps around the end of the buffer
+ * The wait for a free period paces the thread
+ */
+static void mmap_period(audio_t *audio)
+{
+    snd_pcm_t *handle = audio->handle;
+
+    snd_pcm_sframes_t avail = wait_period(audio);
+    if (avail < 0)
+    {
+        recover(audio, avail);
+        return;
+    }
+    if (avail < audio->period)
+    {
+        return;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    snd_pcm_uframes_t remaining = audio->period;
+    while (remaining > 0)
+    {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset, frames = remaining;
+        int err = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+        if (err < 0)
+        {
+            recover(audio, err);
+            return;
+        }
+
+        /* Mono 16 bits samples, the frames of the area follow each other */
+        short *buffer = (short *)((char *)areas[0].addr + areas[0].first / 8) + offset;
+        play_block(audio, buffer, frames);
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, frames);
+        if (committed < 0 || (snd_pcm_uframes_t)committed != frames)
+        {
+            recover(audio, (committed < 0) ? committed : -EPIPE);
+            return;
+        }
+        remaining -= frames;
+    }
+
+    record_render_time(audio, &start);
+    record_delay(audio);
+}
+
+/*
+ * Audio thread main loop
+ * Takes the newest parameters and notes, then plays a period,
+ * straight into the sound card buffer if it is memory mapped
+ * The stack is touched first, so that playing never page faults on it
+ */
+static void *audio_thread(void *arg)
+{
+    audio_t *audio = arg;
+
+    realtime_prefault_stack();
+
+    while (atomic_load(&audio->running))
+    {
+        update_synth(audio);
+        if (audio->mmap)
+        {
+            mmap_period(audio);
+        }
+        else
+        {
+            write_period(audio);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Open the default ALSA playback device with the sample rate, period and periods
+ * The period and periods are set to the nearest ones the device accepts,
+ * the access is memory mapped if the device supports it
+ * Returns 1 if the device can't be opened or doesn't support the parameters
+ */
+int audio_open(audio_t *audio)
+{
+    audio->handle = NULL;
+    if (snd_pcm_open(&audio->handle, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0)
+    {
+        fprintf(stderr, "error while opening sound card.\n");
+        audio->handle = NULL;
+        return 1;
+    }
+
+    snd_pcm_hw_params_t *hw_params;
+    snd_pcm_hw_params_alloca(&hw_params);
+    snd_pcm_uframes_t period = audio->period;
+    unsigned int periods = audio->periods;
+
+    /* The rate is exact, the synth renders at it, the period and periods are the nearest ones */
+    int params_err = snd_pcm_hw_params_any(audio->handle, hw_params);
+
+    /* Memory mapped access when the device supports it, read and write access otherwise */
+    audio->mmap = params_err >= 0 &&
+                  snd_pcm_hw_params_set_access(audio->handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) >= 0;
+    if (params_err >= 0 && !audio->mmap)
+    {
+        params_err = snd_pcm_hw_params_set_access(audio->handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+    }
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_hw_params_set_format(audio->handle, hw_params, SND_PCM_FORMAT_S16_LE);
+    }
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_hw_params_set_channels(audio->handle, hw_params, MONO);
+    }
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_hw_params_set_rate(audio->handle, hw_params, audio->rate, 0);
+    }
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_hw_params_set_period_size_near(audio->handle, hw_params, &period, NULL);
+    }
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_hw_params_set_periods_near(audio->handle, hw_params, &periods, NULL);
+    }
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_hw_params(audio->handle, hw_params);
+    }
+
+    if (params_err < 0)
+    {
+        fprintf(stderr, "error while setting sound card parameters: %s\n", snd_strerror(params_err));
+        return 1;
+    }
+
+    if (period > FRAMES)
+    {
+        fprintf(stderr, "the sound card period of %lu frames is over %d frames.\n", (unsigned long)period, FRAMES);
+        return 1;
+    }
+    audio->period = period;
+    audio->periods = periods;
+
+    /*
+     * The sound card only starts once its buffer is full, so that the priming period
+     * doesn't start it before the audio thread, and wakes up at every free period
+     */
+    snd_pcm_uframes_t buffer_size;
+    snd_pcm_hw_params_get_buffer_size(hw_params, &buffer_size);
+
+    snd_pcm_sw_params_t *sw_params;
+    snd_pcm_sw_params_alloca(&sw_params);
+    params_err = snd_pcm_sw_params_current(audio->handle, sw_params);
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_sw_params_set_start_threshold(audio->handle, sw_params, buffer_size);
+    }
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_sw_params_set_avail_min(audio->handle, sw_params, period);
+    }
+    if (params_err >= 0)
+    {
+        params_err = snd_pcm_sw_params(audio->handle, sw_params);
+    }
+
+    if (params_err < 0)
+    {
+        fprintf(stderr, "error while setting sound card software parameters: %s\n", snd_strerror(params_err));
+        return 1;
+    }
+
+    snd_pcm_prepare(audio->handle);
+
+    /* The audio thread waits on the descriptors, the writes never block */
+    audio->nfds = snd_pcm_poll_descriptors_count(audio->handle);
+    if (audio->nfds <= 0 || audio->nfds > AUDIO_POLL_FDS)
+    {
+        fprintf(stderr, "the sound card has %d poll descriptors, up to %d are supported.\n", audio->nfds, AUDIO_POLL_FDS);
+        return 1;
+    }
+    snd_pcm_poll_descriptors(audio->handle, audio->fds, audio->nfds);
+    snd_pcm_nonblock(audio->handle, 1);
+
+    /* Priming the sound card with a silent period */
+    short silence[FRAMES] = {0};
+    if (audio->mmap)
+    {
+        snd_pcm_mmap_writei(audio->handle, silence, audio->period);
+    }
+    else
+    {
+        snd_pcm_writei(audio->handle, silence, audio->period);
+    }
+
+    return 0;
+}
+
+/*
+ * Start the audio thread, with its real-time priority and CPU core if set
+ * Returns 1 if the thread couldn't be created
+ */
+int audio_start(audio_t *audio)
+{
+    atomic_store(&audio->running, true);
+    if (realtime_create(&audio->thread, audio_thread, audio) != 0)
+    {
+        fprintf(stderr, "error while creating the audio thread.\n");
+        atomic_store(&audio->running, false);
+        return 1;
+    }
+
+    /* Without the permissions, the thread keeps playing with the normal scheduling */
+    realtime_thread(audio->thread, audio->priority, audio->cpu);
+
+    return 0;
+}
+
+/* Stop the audio thread and wait for it to finish */
+void audio_stop(audio_t *audio)
+{
+    atomic_store(&audio->running, false);
+    pthread_join(audio->thread, NULL);
+}
+
+/* Drain and close the ALSA playback device */
+void audio_close(audio_t *audio)
+{
+    if (audio->handle)
+    {
+        /* Draining waits for the buffer to be played */
+        snd_pcm_nonblock(audio->handle, 0);
+        snd_pcm_drain(audio->handle);
+        snd_pcm_close(audio->handle);
+        audio->handle = NULL;
+    }
+}
@@ -0,0 +1,163 @@
+#include <string.h>
+
+#include "defs.h"
+#include "control.h"
+
+/* Give the first slots to the writer and the reader, the third one is exchanged */
+static void triple_init(triple_buffer_t *buffer)
+{
+    buffer->write = 0;
+    buffer->read = 1;
+    atomic_init(&buffer->state, 2);
+}
+
+/* Exchange the written slot, the writer gets back the previously exchanged one */
+static void triple_publish(triple_buffer_t *buffer)
+{
+    unsigned int state = atomic_exchange_explicit(
+        &buffer->state, buffer->write | TRIPLE_FRESH, memory_order_acq_rel);
+    buffer->write = state & ~TRIPLE_FRESH;
+}
+
+/* Take the exchanged slot if it is newer, returns the reader slot */
+static unsigned int triple_acquire(triple_buffer_t *buffer)
+{
+    if (atomic_load_explicit(&buffer->state, memory_order_relaxed) & TRIPLE_FRESH)
+    {
+        unsigned int state = atomic_exchange_explicit(
+            &buffer->state, buffer->read, memory_order_acq_rel);
+        buffer->read = state & ~TRIPLE_FRESH;
+    }
+    return buffer->read;
+}
+
+/*
+ * Push an event at the head of the queue
+ * Returns 1 if the queue is full
+ */
+static int queue_push(event_queue_t *queue, synth_event_type_t type, int note, int velocity)
+{
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if (head - tail >= CONTROL_EVENTS)
+    {
+        return 1;
+    }
+
+    synth_event_t *event = &queue->events[head & (CONTROL_EVENTS - 1)];
+    event->type = type;
+    event->note = note;
+    event->velocity = velocity;
+
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return 0;
+}
+
+/*
+ * Pop the event at the tail of the queue
+ * Returns false if the queue is empty
+ */
+static bool queue_pop(event_queue_t *queue, synth_event_t *event)
+{
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (head == tail)
+    {
+        return false;
+    }
+
+    *event = queue->events[tail & (CONTROL_EVENTS - 1)];
+
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/* Initialize the transport with the first parameters and an empty display */
+void control_init(control_t *control, const synth_params_t *params)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        control->params[i] = *params;
+        memset(&control->display[i], 0, sizeof(synth_display_t));
+        control->display[i].arp_note = -1;
+    }
+    triple_init(&control->params_buffer);
+    triple_init(&control->display_buffer);
+
+    atomic_init(&control->gui_events.head, 0);
+    atomic_init(&control->gui_events.tail, 0);
+    atomic_init(&control->midi_events.head, 0);
+    atomic_init(&control->midi_events.tail, 0);
+}
+
+/* Publish a copy of the parameters to the audio thread, never blocks */
+void control_publish_params(control_t *control, const synth_params_t *params)
+{
+    control->params[control->params_buffer.write] = *params;
+    triple_publish(&control->params_buffer);
+}
+
+/*
+ * Take the newest parameters published by the GUI thread
+ * Returns the parameters, valid until the next call
+ */
+const synth_params_t *control_acquire_params(control_t *control)
+{
+    return &control->params[triple_acquire(&control->params_buffer)];
+}
+
+/*
+ * Push a note event from the GUI thread to the audio thread, never blocks
+ * Returns 1 if the queue is full and the event was dropped
+ */
+int control_push_event(control_t *control, synth_event_type_t type,
+                       int note, int velocity)
+{
+    return queue_push(&control->gui_events, type, note, velocity);
+}
+
+/*
+ * Push a note event from the MIDI thread to the audio thread, never blocks
+ * Returns 1 if the queue is full and the event was dropped
+ */
+int control_push_midi_event(control_t *control, synth_event_type_t type,
+                            int note, int velocity)
+{
+    return queue_push(&control->midi_events, type, note, velocity);
+}
+
+/*
+ * Pop the oldest note event of the GUI thread, else of the MIDI thread
+ * Returns false if both queues are empty
+ */
+bool control_pop_event(control_t *control, synth_event_t *event)
+{
+    return queue_pop(&control->gui_events, event) ||
+           queue_pop(&control->midi_events, event);
+}
+
+/*
+ * Returns the display slot owned by the audio thread,
+ * to be filled whole before calling control_publish_display
+ */
+synth_display_t *control_display_slot(control_t *control)
+{
+    return &control->display[control->display_buffer.write];
+}
+
+/* Publish the filled display slot to the GUI thread, never blocks */
+void control_publish_display(control_t *control)
+{
+    triple_publish(&control->display_buffer);
+}
+
+/*
+ * Take the newest display state published by the audio thread
+ * Returns the display state, valid until the next call
+ */
+const synth_display_t *control_acquire_display(control_t *control)
+{
+    return &control->display[triple_acquire(&control->display_buffer)];
+}
@@ -0,0 +1,156 @@
+#include <stdbool.h>
+
+#include "defs.h"
+#include "dsp.h"
+
+/* Instruction set of a kernels table, with its CLI name and its CPU support check */
+typedef struct
+{
+    const char *name;
+    const dsp_kernels_t *kernels;
+    bool (*supported)(void);
+} dsp_variant_t;
+
+/* The scalar kernels run everywhere */
+static bool always_supported(void)
+{
+    return true;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * The CPU features are read with cpuid, the AVX ones are also checked
+ * against the registers state the OS saves (xgetbv)
+ */
+static bool sse2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+static bool avx2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static bool avx512_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+#endif
+
+/* Instruction sets from the slowest to the fastest */
+static const dsp_variant_t dsp_variants[] =
+    {
+        {"scalar", &dsp_kernels_scalar, always_supported},
+#if defined(__x86_64__) || defined(__i386__)
+        {"sse2", &dsp_kernels_sse2, sse2_supported},
+        {"avx2", &dsp_kernels_avx2, avx2_supported},
+        {"avx512", &dsp_kernels_avx512, avx512_supported},
+#endif
+};
+
+#define DSP_VARIANTS (int)(sizeof(dsp_variants) / sizeof(dsp_variants[0]))
+
+/* Selected kernels, the baseline ones until dsp_init is called */
+#if defined(__x86_64__) || defined(__i386__)
+static const dsp_kernels_t *dsp = &dsp_kernels_sse2;
+#else
+static const dsp_kernels_t *dsp = &dsp_kernels_scalar;
+#endif
+
+/*
+ * Select the kernels of an instruction set : scalar, sse2, avx2 or avx512
+ * If name is NULL, the SYNTH_SIMD environment variable is read instead,
+ * if it isn't set either the fastest instruction set of the CPU is picked
+ * Returns 1 if the instruction set is unknown or not supported by the CPU
+ */
+int dsp_init(const char *name)
+{
+    if (name == NULL)
+    {
+        name = getenv("SYNTH_SIMD");
+    }
+
+    if (name == NULL || name[0] == '\0')
+    {
+        for (int v = DSP_VARIANTS - 1; v >= 0; v--)
+        {
+            if (dsp_variants[v].supported())
+            {
+                dsp = dsp_variants[v].kernels;
+                return 0;
+            }
+        }
+    }
+
+    for (int v = 0; v < DSP_VARIANTS; v++)
+    {
+        if (strcmp(dsp_variants[v].name, name) != 0)
+        {
+            continue;
+        }
+        if (!dsp_variants[v].supported())
+        {
+            fprintf(stderr, "the %s instruction set isn't supported by this CPU.\n", name);
+            return 1;
+        }
+        dsp = dsp_variants[v].kernels;
+        return 0;
+    }
+
+    fprintf(stderr, "unknown instruction set %s.\n", name);
+    return 1;
+}
+
+/* Returns the name of the SIMD instruction set of the selected kernels */
+const char *dsp_simd_name(void)
+{
+    return dsp->name;
+}
+
+/*
+ * Render the voices of the pool into the buffer, adding to its content
+ * Only the voices of the active list are rendered, they are gathered
+ * a SIMD vector at a time, one lane per voice
+ * The voices are split in chunks rendered by the worker pool if it isn't NULL,
+ * the chunks are always summed in the same order so the output doesn't depend on the pool
+ * The waveforms of the voices are read from the parameters,
+ * their envelopes from the envelope coefficients
+ * With the voice filters parameter, each voice goes through its own filter of the filter type,
+ * at the sample rate, its cutoff modulations being evaluated every control_rate samples
+ * The oscillators read the wavetables if they are not NULL
+ * If only_voice is not -1, the other voices are left untouched (arpeggiator),
+ * except the spare voices fading out the stolen ones
+ * The amp buffer holds the amplification of each sample
+ * If lfo is not NULL, it holds the LFO automation of the parameter it modulates,
+ * the detuned oscillators follow it between the base frequency and the one
+ * detuned by the detune ratio, the voice filters scale their cutoff by it
+ */
+void dsp_render_voices(voices_t *voices, const synth_params_t *params,
+                       const adsr_coefs_t *envelope, const adsr_coefs_t *filter_envelope,
+                       const wavetables_t *wavetables, pool_t *pool,
+                       float *buffer, const float *amp, const float *lfo,
+                       float detune_ratio, int rate, int control_rate,
+                       int only_voice, int nframes)
+{
+    dsp->render_voices(voices, params, envelope, filter_envelope, wavetables, pool,
+                       buffer, amp, lfo, detune_ratio, rate, control_rate, only_voice, nframes);
+}
+
+/*
+ * Convert a buffer of samples to 16 bits samples
+ * The samples are clipped between -1.0 and 1.0 first
+ */
+void dsp_to_s16(const float *input, short *output, int nframes)
+{
+    dsp->to_s16(input, output, nframes);
+}
+
+/* Clip a buffer of 16 bits samples between -clip and clip, then apply the gain */
+void dsp_clip_s16(short *buffer, int nframes, short clip, float gain)
+{
+    dsp->clip_s16(buffer, nframes, clip, gain);
+}
@@ -0,0 +1,8 @@
+/* AVX2 DSP kernels, the makefile compiles this file with -mavx2 */
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __AVX2__
+#error "dsp_avx2.c must be compiled with -mavx2"
+#endif
+#define DSP_KERNELS dsp_kernels_avx2
+#include "dsp_kernels.inc"
+#endif
@@ -0,0 +1,8 @@
+/* AVX-512 DSP kernels, the makefile compiles this file with -mavx512f */
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __AVX512F__
+#error "dsp_avx512.c must be compiled with -mavx512f"
+#endif
+#define DSP_KERNELS dsp_kernels_avx512
+#include "dsp_kernels.inc"
+#endif
@@ -0,0 +1,4 @@
+/* Scalar DSP kernels, built for every architecture */
+#define DSP_FORCE_SCALAR
+#define DSP_KERNELS dsp_kernels_scalar
+#include "dsp_kernels.inc"
@@ -0,0 +1,8 @@
+/* SSE2 DSP kernels, the x86-64 baseline */
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef __SSE2__
+#error "dsp_sse2.c must be compiled with -msse2"
+#endif
+#define DSP_KERNELS dsp_kernels_sse2
+#include "dsp_kernels.inc"
+#endif
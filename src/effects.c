@@ -1,8 +1,9 @@
 #include "defs.h"
 #include "effects.h"
+#include "dsp.h"
 
 /* Applies an amount of distortion onto a sound buffer */
-short distortion(short sample, float amount, bool overdriving)
+void distortion(short *buffer, int nframes, float amount, bool overdriving)
 {
     if (amount > 1.0)
     {
@@ -25,16 +26,8 @@ short distortion(short sample, float amount, bool overdriving)
         clip = 32767 *  (1 - amount);
     }
 
-    if (sample > clip)
-    {
-        sample = clip;
-    }
-    else if (sample < -clip)
-    {
-        sample = -clip;
-    }
-
     /* Gain to avoid silencing when amount is high */
-    sample *= 1.0 + (1.0 - clip / 32767.0);  
-    return sample;   
+    double gain = 1.0 + (1.0 - clip / 32767.0);
+
+    dsp_clip_s16(buffer, nframes, clip, gain);
 }
\ No newline at end of file
@@ -0,0 +1,157 @@
+#define _GNU_SOURCE
+#include <math.h>
+
+#include "defs.h"
+#include "filter.h"
+
+/*
+ * Fast tanh approximation, used to saturate the ladder feedback
+ * The rational curve reaches -1.0 and 1.0 at -3.0 and 3.0 and is clipped past them,
+ * the error is below 0.025
+ */
+float fast_tanh(float x)
+{
+    if (x > 3.0f)
+    {
+        x = 3.0f;
+    }
+    else if (x < -3.0f)
+    {
+        x = -3.0f;
+    }
+
+    float square = x * x;
+    return x * (27.0f + square) / (27.0f + 9.0f * square);
+}
+
+/*
+ * Returns the coefficient of a filter type for a cutoff between 0.0 and 1.0 at the sample rate
+ * The one-pole and ladder filters use the one-pole low-pass coefficient,
+ * the state-variable filter uses the gain of its integrators
+ */
+float filter_coefficient(int type, float cutoff, int rate)
+{
+    /* Clipping */
+    if (cutoff > 1.0f)
+    {
+        cutoff = 1.0f;
+    }
+    if (cutoff < 0.0f)
+    {
+        cutoff = 0.0f;
+    }
+
+    /* Every filter shares the cutoff range, up to FILTER_MAX_FREQ whatever the sample rate */
+    float frequency = cutoff * FILTER_MAX_FREQ;
+    float omega = 2.0f * M_PI * frequency / rate;
+
+    switch (type)
+    {
+    case SVF_LOWPASS:
+    case SVF_HIGHPASS:
+    case SVF_BANDPASS:
+    case SVF_NOTCH:
+        return tanf(omega / 2.0f);
+    default:
+        return omega / (omega + 1.0f);
+    }
+}
+
+/* Returns the damping of the state-variable filter for a resonance between 0.0 and 1.0 */
+float svf_damping(float resonance)
+{
+    /* The damping never reaches 0, where the filter would ring forever */
+    return 2.0f - 1.96f * fminf(fmaxf(resonance, 0.0f), 1.0f);
+}
+
+/* Returns the feedback of the ladder filter for a resonance between 0.0 and 1.0 */
+float ladder_feedback(float resonance)
+{
+    /* The ladder self-oscillates at a feedback of 4, the saturation bounds it */
+    return 4.0f * fminf(fmaxf(resonance, 0.0f), 1.0f);
+}
+
+/*
+ * Set the weights of the input, band-pass and low-pass outputs
+ * of the state-variable filter that make the output of a mode
+ */
+void svf_mode_mix(int mode, float damping, float mix[3])
+{
+    switch (mode)
+    {
+    case SVF_HIGHPASS:
+        mix[0] = 1.0f, mix[1] = -damping, mix[2] = -1.0f;
+        break;
+    case SVF_BANDPASS:
+        mix[0] = 0.0f, mix[1] = 1.0f, mix[2] = 0.0f;
+        break;
+    case SVF_NOTCH:
+        mix[0] = 1.0f, mix[1] = -damping, mix[2] = 0.0f;
+        break;
+    default:
+        mix[0] = 0.0f, mix[1] = 0.0f, mix[2] = 1.0f;
+        break;
+    }
+}
+
+/*
+ * Process a buffer in place with a 2-pole state-variable filter in the given mode
+ * The state holds the 2 integrators, the gain ramps linearly from from to to
+ */
+void svf_process_block(float *state, int mode, float *buffer,
+                       float from, float to, float damping, int nframes)
+{
+    float g = from;
+    float step = (to - from) / nframes;
+    float ic1 = state[0], ic2 = state[1];
+    float mix[3];
+    svf_mode_mix(mode, damping, mix);
+
+    for (int i = 0; i < nframes; i++)
+    {
+        /* Trapezoidal integrators, solved without the unit delay */
+        g += step;
+        float a1 = 1.0f / (1.0f + g * (g + damping));
+        float a2 = g * a1;
+        float a3 = g * a2;
+
+        float input = buffer[i];
+        float v3 = input - ic2;
+        float band = a1 * ic1 + a2 * v3;
+        float low = ic2 + a2 * ic1 + a3 * v3;
+        ic1 = 2.0f * band - ic1;
+        ic2 = 2.0f * low - ic2;
+
+        buffer[i] = mix[0] * input + mix[1] * band + mix[2] * low;
+    }
+
+    state[0] = ic1;
+    state[1] = ic2;
+}
+
+/*
+ * Process a buffer in place with a 4-pole ladder filter
+ * The state holds the output of the 4 stages, the coefficient ramps linearly
+ * from from to to, the feedback of the last stage is saturated
+ */
+void ladder_process_block(float *state, float *buffer,
+                          float from, float to, float feedback, int nframes)
+{
+    float alpha = from;
+    float step = (to - from) / nframes;
+
+    /* The resonance thins the passband, half of it is given back */
+    float gain = 1.0f + feedback * 0.5f;
+
+    for (int i = 0; i < nframes; i++)
+    {
+        alpha += step;
+        float stage = fast_tanh(buffer[i] - feedback * state[3]);
+        for (int s = 0; s < FILTER_STAGES; s++)
+        {
+            state[s] += alpha * (stage - state[s]);
+            stage = state[s];
+        }
+        buffer[i] = stage * gain;
+    }
+}
@@ -6,15 +6,21 @@
 #include "defs.h"
 #include "interface.h"
 #include "synth.h"
+#include "control.h"
 
 /* Render the ADSR envelope sliders */
 void render_adsr(
     float *attack, float *decay, 
-    float *sustain, float *release)
+    float *sustain, float *release,
+    bool *exponential)
 {
     /* ADSR envelope sliders */
     GuiGroupBox((Rectangle){30, 40, 550, 160}, "ADSR Envelope");
 
+    /* Exponential segments for both envelopes */
+    GuiLabel((Rectangle){515, 48, 30, 15}, "Exp");
+    GuiCheckBox((Rectangle){550, 48, 15, 15}, NULL, exponential);
+
     GuiLabel((Rectangle){150, 50, 100, 20}, "Attack");
     GuiSlider((Rectangle){60, 70, 225, 40}, NULL, NULL,
               attack, 0.0f, 2.0f);
@@ -33,26 +39,26 @@ void render_adsr(
 }
 
 /* Render the filter ADSR envelope sliders */
-void render_filter_adsr(synth_t *synth)
+void render_filter_adsr(synth_params_t *params)
 {
     /* Filter ADSR envelope sliders */
     GuiGroupBox((Rectangle){610, 40, 550, 160}, "Filter ADSR Envelope");
 
     GuiLabel((Rectangle){730, 50, 100, 20}, "Attack");
     GuiSlider((Rectangle){640, 70, 225, 40}, NULL, NULL,
-              synth->filter->adsr->attack, 0.0f, 2.0f);
+              &params->filter_attack, 0.0f, 2.0f);
 
     GuiLabel((Rectangle){730, 120, 100, 20}, "Decay");
     GuiSlider((Rectangle){640, 140, 225, 40}, NULL, NULL,
-              synth->filter->adsr->decay, 0.0f, 2.0f);
+              &params->filter_decay, 0.0f, 2.0f);
 
     GuiLabel((Rectangle){990, 50, 100, 20}, "Sustain");
     GuiSlider((Rectangle){900, 70, 225, 40}, NULL, NULL,
-              synth->filter->adsr->sustain, 0.0f, 1.0f);
+              &params->filter_sustain, 0.0f, 1.0f);
 
     GuiLabel((Rectangle){990, 120, 100, 20}, "Release");
     GuiSlider((Rectangle){900, 140, 225, 40}, NULL, NULL,
-              synth->filter->adsr->release, 0.0f, 1.0f);
+              &params->filter_release, 0.0f, 1.0f);
 }
 
 /* Render the oscillators waveforms dropdown menus*/
@@ -91,46 +97,59 @@ void render_osc_waveforms(
 }
 
 /* Render the synthesizer parameters */
-void render_synth_params(synth_t *synth)
+void render_synth_params(
+    synth_params_t *params, const synth_display_t *display,
+    bool *filter_ddm)
 {
     /* Synth parameters */
     GuiGroupBox((Rectangle){610, 230, 550, 160}, "Synth parameters");
 
     GuiLabel((Rectangle){730, 240, 100, 20}, "Amp");
     GuiSlider((Rectangle){640, 260, 225, 40}, NULL, NULL,
-              &synth->amp, 0.0f, 1.0f);
-    if (synth->lfo->mod_param == LFO_AMP)
+              &params->amp, 0.0f, 1.0f);
+    if (params->lfo_param == LFO_AMP)
     {
-        DrawRectangle(640, 260, 225 * synth->lfo_amp, 40, GRAY);
+        DrawRectangle(640, 260, 225 * display->lfo_amp, 40, GRAY);
     }
        
-    GuiLabel((Rectangle){730, 310, 100, 20}, "Cutoff");
-    GuiSlider((Rectangle){640, 330, 225, 40}, NULL, NULL,
-              &synth->filter->cutoff, 0.0f, 2.0f);
-    if (synth->lfo->mod_param == LFO_CUTOFF)
+    GuiLabel((Rectangle){675, 310, 100, 20}, "Cutoff");
+    GuiSlider((Rectangle){640, 330, 110, 40}, NULL, NULL,
+              &params->cutoff, 0.0f, 2.0f);
+    if (params->lfo_param == LFO_CUTOFF)
     {
-        DrawRectangle(640, 330, 225 * (synth->filter->lfo_cutoff / 2), 40, GRAY);
+        DrawRectangle(640, 330, 110 * (display->lfo_cutoff / 2), 40, GRAY);
     }
 
+    GuiLabel((Rectangle){780, 310, 100, 20}, "Resonance");
+    GuiSlider((Rectangle){765, 330, 100, 40}, NULL, NULL,
+              &params->resonance, 0.0f, 1.0f);
+
     GuiLabel((Rectangle){990, 240, 100, 20}, "Detune");
-    if (GuiSlider((Rectangle){900, 260, 225, 40}, NULL, NULL,
-              &synth->detune, 0.0f, 1.0f))
-    {
-        apply_detune_change(synth);
-    }
+    GuiSlider((Rectangle){900, 260, 225, 40}, NULL, NULL,
+              &params->detune, 0.0f, 1.0f);
        
-    if (synth->lfo->mod_param == LFO_DETUNE)
+    if (params->lfo_param == LFO_DETUNE)
     {
-        DrawRectangle(900, 260, 225 * synth->lfo_detune, 40, GRAY);
+        DrawRectangle(900, 260, 225 * display->lfo_detune, 40, GRAY);
     }
         
-    GuiCheckBox((Rectangle){900, 330, 40, 40}, "Filter ADSR",
-                &synth->filter->env);
+    GuiCheckBox((Rectangle){1035, 325, 20, 20}, "Filter ADSR",
+                &params->filter_env);
+    GuiCheckBox((Rectangle){1035, 355, 20, 20}, "Poly",
+                &params->voice_filters);
+
+    GuiLabel((Rectangle){930, 310, 100, 20}, "Filter type");
+    if (GuiDropdownBox((Rectangle){900, 330, 120, 40},
+                       "One-pole;SVF LP;SVF HP;SVF BP;SVF Notch;Ladder",
+                       &params->filter_type, *filter_ddm))
+    {
+        *filter_ddm = !*filter_ddm;
+    }
 }
 
 /* Render the options menu */
 void render_options(
-    synth_t *synth,
+    control_t *control, synth_params_t *params,
     char *audio_filename,
     bool *saving_preset, bool *loading_preset,
     bool *saving_audio_file, bool *recording)
@@ -181,37 +200,34 @@ void render_options(
         DrawRectangleRounded((Rectangle){1340, 340, 5, 40}, 0.2, 10, RED);
     }
         
-    if (GuiCheckBox((Rectangle){1350, 240, 40, 40}, "Arpeggiator", &synth->arp))
+    if (GuiCheckBox((Rectangle){1350, 240, 40, 40}, "Arpeggiator", &params->arp))
     {
-        for (int v = 0; v < VOICES; v++)
-        {
-            synth->voices[v].adsr->state = ENV_IDLE;
-            synth->voices[v].pressed = 0;
-        }
+        control_push_event(control, EVENT_RESET, 0, 0);
     }
 
     GuiLabel((Rectangle){1400, 290, 100, 20}, "BPM");
-    GuiSlider((Rectangle){1350, 310, 225, 40}, NULL, NULL, &synth->bpm, 0.0, 250.0);
+    GuiSlider((Rectangle){1350, 310, 225, 40}, NULL, NULL, &params->bpm, 0.0, 250.0);
+
+    GuiLabel((Rectangle){1640, 290, 100, 20}, "Glide");
+    GuiSlider((Rectangle){1600, 310, 125, 40}, NULL, NULL, &params->glide, 0.0, MAX_GLIDE);
 }
 
 /* Render the effects parameters */
 void render_effects(
-    synth_t *synth, 
-    bool *lfo_wave_ddm, bool *lfo_params_ddm,
-    bool *distortion, bool *overdrive,
-    float *distortion_amount)
+    synth_params_t *params, 
+    bool *lfo_wave_ddm, bool *lfo_params_ddm)
 {
     /* Effects */
     GuiGroupBox((Rectangle){1190, 40, 554, 160}, "Effects");
 
     GuiLabel((Rectangle){1210 + 265 / 2 - 120 / 2, 120, 120, 20}, "LFO frequency");
     GuiSlider((Rectangle){1210, 140, 265, 40}, NULL, NULL,
-              &synth->lfo->osc->freq, 0.0f, 1.0f);
+              &params->lfo_freq, 0.0f, 1.0f);
 
     GuiLabel((Rectangle){1210 + 130 / 2 - 80 / 2, 50, 80, 20}, "LFO wave");
     if (GuiDropdownBox((Rectangle){1210, 70, 130, 40},
                        "#01#Sine;#02#Square;#03#Triangle;#04#Sawtooth",
-                       synth->lfo->osc->wave, *lfo_wave_ddm))
+                       &params->lfo_wave, *lfo_wave_ddm))
     {
         *lfo_wave_ddm = !*lfo_wave_ddm;
     }
@@ -219,25 +235,25 @@ void render_effects(
     GuiLabel((Rectangle){1345 + 130 / 2 - 100 / 2, 50, 100, 20}, "LFO param");
     if (GuiDropdownBox((Rectangle){1345, 70, 130, 40},
                        "#01#Off;#02#Cutoff;#03#Detune;#04#Amp",
-                       &synth->lfo->mod_param, *lfo_params_ddm))
+                       &params->lfo_param, *lfo_params_ddm))
     {
         *lfo_params_ddm = !*lfo_params_ddm;
     }
         
     /* Distortion */
     GuiLabel((Rectangle){1540 - 25, 50, 100, 20}, "Distortion");
-    GuiCheckBox((Rectangle){1540, 70, 40, 40}, NULL, distortion);
+    GuiCheckBox((Rectangle){1540, 70, 40, 40}, NULL, &params->distortion);
 
     GuiLabel((Rectangle){1650 - 25, 50, 100, 20}, "Overdrive");
-    GuiCheckBox((Rectangle){1650, 70, 40, 40}, NULL, overdrive);
+    GuiCheckBox((Rectangle){1650, 70, 40, 40}, NULL, &params->overdrive);
 
     GuiLabel((Rectangle){1500 + 225 / 2 - 160 / 2, 120, 160, 20}, "Distortion amount");
     GuiSlider((Rectangle){1500, 140, 225, 40}, NULL, NULL,
-              distortion_amount, 0.0f, 1.0f);
+              &params->distortion_amount, 0.0f, 1.0f);
 }
 
 /* Renders the waveform generated by the render_synth function */
-void render_waveform(short *buffer)
+void render_waveform(const short *buffer)
 {
     GuiGroupBox((Rectangle){30, 420, WIDTH - 55, 160}, "Waveform");
 
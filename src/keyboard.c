@@ -1,193 +1,101 @@
 #include "defs.h"
-#include "synth.h"
+#include "control.h"
 #include "keyboard.h"
 
 /*
  * Get the keyboard input from the SDL key event and the keyboard layout (QWERTY or AZERTY)
- * Change the synth_t voices frequencies with the assigned note
+ * Send the assigned notes to the audio thread
  * Change the ADSR parameters when the assigned keys are being pressed
  * Change the cutoff, detune and amplification when the assigned keys are being pressed
  * Change the keyboard octave when UP or DOWN keys are being pressed
  */
-void handle_input(synth_t *synth, int *octave)
+void handle_input(control_t *control, int *octave)
 {
     int octave_length = *octave * 12;
 
     if (IsKeyPressed(kC))
-        assign_note(synth, octave_length + nC);
+        assign_note(control, octave_length + nC);
     if (IsKeyPressed(kC_SHARP))
-        assign_note(synth, octave_length + nC_SHARP);
+        assign_note(control, octave_length + nC_SHARP);
     if (IsKeyPressed(kD))
-        assign_note(synth, octave_length + nD);
+        assign_note(control, octave_length + nD);
     if (IsKeyPressed(kD_SHARP))
-        assign_note(synth, octave_length + nD_SHARP);
+        assign_note(control, octave_length + nD_SHARP);
     if (IsKeyPressed(kE))
-        assign_note(synth, octave_length + nE);
+        assign_note(control, octave_length + nE);
     if (IsKeyPressed(kF))
-        assign_note(synth, octave_length + nF);
+        assign_note(control, octave_length + nF);
     if (IsKeyPressed(kF_SHARP))
-        assign_note(synth, octave_length + nF_SHARP);
+        assign_note(control, octave_length + nF_SHARP);
     if (IsKeyPressed(kG))
-        assign_note(synth, octave_length + nG);
+        assign_note(control, octave_length + nG);
     if (IsKeyPressed(kG_SHARP))
-        assign_note(synth, octave_length + nG_SHARP);
+        assign_note(control, octave_length + nG_SHARP);
     if (IsKeyPressed(kA))
-        assign_note(synth, octave_length + nA);
+        assign_note(control, octave_length + nA);
     if (IsKeyPressed(kA_SHARP))
-        assign_note(synth, octave_length + nA_SHARP);
+        assign_note(control, octave_length + nA_SHARP);
     if (IsKeyPressed(kB))
-        assign_note(synth, octave_length + nB);
-    if (IsKeyPressed(KEY_UP))
+        assign_note(control, octave_length + nB);
+    /* Every key of the octave stays in the MIDI range */
+    if (IsKeyPressed(KEY_UP) && *octave < MAX_OCTAVE)
     {
         (*octave)++;
         /* Releasing all of the voices so that some notes 
         don't get stucked when sustain is not at 0.0 */
-        for (int v = 0; v < VOICES; v++)
-        {
-            synth->voices[v].adsr->state = ENV_IDLE;
-            synth->voices[v].pressed = 0;
-            synth->voices[v].note = -1;
-        }
+        control_push_event(control, EVENT_RESET, 0, 0);
     }
-    else if (IsKeyPressed(KEY_DOWN))
+    else if (IsKeyPressed(KEY_DOWN) && *octave > MIN_OCTAVE)
     {
         (*octave)--;
         /* Releasing all of the voices so that some notes 
         don't get stucked when sustain is not at 0.0 */
-        for (int v = 0; v < VOICES; v++)
-        {
-            synth->voices[v].adsr->state = ENV_IDLE;
-            synth->voices[v].pressed = 0;
-            synth->voices[v].note = -1;
-        }
-            
+        control_push_event(control, EVENT_RESET, 0, 0);
     }
 }
 
 /* Free the synth voices when their assigned note key are being released */
-void handle_release(synth_t *synth, int octave)
+void handle_release(control_t *control, int octave)
 {
     int octave_length = octave * 12;
     
     if (IsKeyReleased(kC))
-        release_note(synth, octave_length + nC);
+        release_note(control, octave_length + nC);
     if (IsKeyReleased(kC_SHARP))
-        release_note(synth, octave_length + nC_SHARP);
+        release_note(control, octave_length + nC_SHARP);
     if (IsKeyReleased(kD))
-        release_note(synth, octave_length + nD);
+        release_note(control, octave_length + nD);
     if (IsKeyReleased(kD_SHARP))
-        release_note(synth, octave_length + nD_SHARP);
+        release_note(control, octave_length + nD_SHARP);
     if (IsKeyReleased(kE))
-        release_note(synth, octave_length + nE);
+        release_note(control, octave_length + nE);
     if (IsKeyReleased(kF))
-        release_note(synth, octave_length + nF);
+        release_note(control, octave_length + nF);
     if (IsKeyReleased(kF_SHARP))
-        release_note(synth, octave_length + nF_SHARP);
+        release_note(control, octave_length + nF_SHARP);
     if (IsKeyReleased(kG))
-        release_note(synth, octave_length + nG);
+        release_note(control, octave_length + nG);
     if (IsKeyReleased(kG_SHARP))
-        release_note(synth, octave_length + nG_SHARP);
+        release_note(control, octave_length + nG_SHARP);
     if (IsKeyReleased(kA))
-        release_note(synth, octave_length + nA);
+        release_note(control, octave_length + nA);
     if (IsKeyReleased(kA_SHARP))
-        release_note(synth, octave_length + nA_SHARP);
+        release_note(control, octave_length + nA_SHARP);
     if (IsKeyReleased(kB))
-        release_note(synth, octave_length + nB);
+        release_note(control, octave_length + nB);
 }
 
-/* Assign a note to a free synth voice */
-void assign_note(synth_t *synth, int midi_note)
+/* Send a note on to the audio thread, which assigns it to a free synth voice */
+void assign_note(control_t *control, int midi_note)
 {
     if (midi_note != -1)
     {
-        int pressed_voices = 0;
-        for (int v = 0; v < VOICES; v++)
-        {
-            if (synth->voices[v].pressed)
-            {
-                pressed_voices++;
-            }
-                
-
-            /* Cutting all the voices that are in ADSR release state to avoid blocking voices */
-            if (synth->voices[v].adsr->state == ENV_RELEASE && !synth->arp)
-            {
-                synth->voices[v].adsr->state = ENV_IDLE;
-            }
-        }
-
-        voice_t *free_voice = get_free_voice(synth);
-        if (free_voice == NULL) 
-        {
-            return;
-        }
-
-        free_voice->pressed = 1;
-        change_freq(free_voice, midi_note, 127, synth->detune);
-        if (pressed_voices == 0 && synth->filter->env)
-        {
-            synth->filter->adsr->state = ENV_ATTACK;
-        }
-            
-
-        if (synth->arp)
-        {
-            sort_synth_voices(synth);
-            if (pressed_voices == 0)
-            {
-                synth->active_arp_float = 1.0;
-            }
-        }
-            
-        return;
+        control_push_event(control, EVENT_NOTE_ON, midi_note, 127);
     }
 }
 
-/* Release a note from a synth voice, does nothing if the note isn't pressed */
-void release_note(synth_t *synth, int midi_note)
-{   
-    int pressed_voices = 0;
-
-    for (int v = 0; v < VOICES; v++)
-    {
-        if (synth->voices[v].pressed)
-        {
-            pressed_voices++;
-        }
-    }
-        
-            
-
-    for (int v = 0; v < VOICES; v++)
-    {
-        if (synth->voices[v].note == midi_note && 
-            synth->voices[v].pressed == 1)
-        {
-            if (synth->arp && synth->voices[v].adsr->state != ENV_IDLE)
-            {
-                synth->voices[v].adsr->state = ENV_IDLE;
-            }
-            else if (
-               !synth->arp && 
-                synth->voices[v].adsr->state != ENV_RELEASE &&
-                synth->voices[v].adsr->state != ENV_IDLE)
-            {
-                synth->voices[v].adsr->state = ENV_RELEASE;
-            }
-                
-            synth->voices[v].note = -1;
-            synth->voices[v].pressed = 0;
-                
-            break;
-        }
-    }
-        
-    if (synth->arp)
-    {
-        sort_synth_voices(synth);
-        if (pressed_voices == 2)
-        {
-            synth->active_arp_float = 1.0;
-        }   
-    }
-}
\ No newline at end of file
+/* Send a note off to the audio thread, does nothing there if the note isn't pressed */
+void release_note(control_t *control, int midi_note)
+{
+    control_push_event(control, EVENT_NOTE_OFF, midi_note, 0);
+}
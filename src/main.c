@@ -1,6 +1,7 @@
 #define RAYGUI_IMPLEMENTATION
 #include <raygui.h>
 #include <unistd.h>
+#include <signal.h>
 #include <alsa/asoundlib.h>
 
 #include "defs.h"
@@ -11,12 +12,43 @@
 #include "record.h"
 #include "effects.h"
 #include "xml.h"
+#include "audio.h"
+#include "control.h"
+#include "pool.h"
+#include "pitch.h"
+#include "dsp.h"
+#include "realtime.h"
+#include "stats.h"
+#include "rtlog.h"
+
+/* Set by SIGUSR1, the stats are written by the GUI thread at its next frame */
+static volatile sig_atomic_t dump_stats = 0;
+
+/* SIGUSR1 handler */
+static void request_stats(int signal)
+{
+    (void)signal;
+    dump_stats = 1;
+}
 
 /* Prints the usage of the CLI arguments into the error output */
 void usage()
 {
     fprintf(stderr, "synth -midi <midi hardware id> : midi keyboard input, able to change parameters of the sounds (ADSR, cutoff, detune and oscillators waveforms)\n");
     fprintf(stderr, "use amidi -l to list your connected midi devices and find your midi device hardware id, often something like : hw:0,0,0 or hw:1,0,0\n");
+    fprintf(stderr, "synth -wavetable [size] : read the oscillators from interpolated wavetables of the given size (power of two, default %d), 0 to compute them\n", WAVETABLE_SIZE);
+    fprintf(stderr, "synth -voices <count> : number of voices of the polyphony, between %d and %d (default %d)\n", MIN_VOICES, MAX_VOICES, VOICES);
+    fprintf(stderr, "synth -steal <oldest|quietest|released> : voice stolen when every voice is busy (default released, then oldest)\n");
+    fprintf(stderr, "synth -threads <count> : worker threads helping the audio thread to render the voices, up to %d (default 0)\n", POOL_MAX_THREADS);
+    fprintf(stderr, "synth -control-rate <samples> : samples between two evaluations of the LFO and the filter envelope, between %d and %d (default %d)\n", MIN_CONTROL_RATE, MAX_CONTROL_RATE, CONTROL_RATE);
+    fprintf(stderr, "synth -simd <scalar|sse2|avx2|avx512> : instruction set of the DSP kernels, also read from the SYNTH_SIMD environment variable (default: the fastest one of the CPU)\n");
+    fprintf(stderr, "synth -rate <44100|48000|96000|192000> : sample rate of the sound card in Hz (default %d)\n", DEFAULT_RATE);
+    fprintf(stderr, "synth -period <frames> : samples rendered and written to the sound card at once, between %d and %d (default %d)\n", MIN_PERIOD, FRAMES, DEFAULT_PERIOD);
+    fprintf(stderr, "synth -periods <count> : periods in the sound card buffer, between %d and %d (default %d)\n", MIN_PERIODS, MAX_PERIODS, DEFAULT_PERIODS);
+    fprintf(stderr, "synth -low-latency : shorthand for -period %d -periods %d\n", LOW_LATENCY_PERIOD, LOW_LATENCY_PERIODS);
+    fprintf(stderr, "synth -realtime [priority] : SCHED_FIFO priority of the audio and worker threads, between 1 and 99 (default %d), and locked memory, the worker threads run one priority under it\n", REALTIME_PRIORITY);
+    fprintf(stderr, "synth -cpu <core> : CPU core the audio thread is pinned on\n");
+    fprintf(stderr, "synth -stats <file> : write the xruns, render times, DSP load and output delay into the file on exit and on SIGUSR1\n");
     fprintf(stderr, "to see this helper again, use synth -h or synth -help\n");
 }
 
@@ -26,19 +58,173 @@ int main(int argc, char **argv)
     char midi_device[256];
     int midi_input = 0;
 
-    if (argc > 1)
+    int wavetable_size = WAVETABLE_DEFAULT ? WAVETABLE_SIZE : 0;
+    int voices_count = VOICES;
+    int steal_policy = STEAL_RELEASED;
+    int threads = 0;
+    int control_rate = CONTROL_RATE;
+    const char *simd = NULL;
+    int rate = DEFAULT_RATE;
+    int period = DEFAULT_PERIOD;
+    int periods = DEFAULT_PERIODS;
+    int priority = 0;
+    int cpu = -1;
+    const char *stats_file = NULL;
+
+    for (int i = 1; i < argc; i++)
     {
-        if (strcmp(argv[1], "-midi") == 0 && argc >= 3)
+        if (strcmp(argv[i], "-midi") == 0 && i + 1 < argc)
         {
             midi_input = 1;
-            strncpy(midi_device, argv[2], sizeof(midi_device) - 1);
+            strncpy(midi_device, argv[++i], sizeof(midi_device) - 1);
             midi_device[sizeof(midi_device) - 1] = '\0';
         }
-        else if (strcmp(argv[1], "-midi") == 0 && argc < 3)
+        else if (strcmp(argv[i], "-midi") == 0)
         {
-            fprintf(stderr, "missing midi hardware device id. \n");
+            fprintf(stderr, "missing midi hardware device id. \n");
             return 1;
         }
+        else if (strcmp(argv[i], "-wavetable") == 0)
+        {
+            /* The size is optional, 0 turns the wavetables off */
+            wavetable_size = WAVETABLE_SIZE;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                char *end_ptr = NULL;
+                wavetable_size = strtol(argv[++i], &end_ptr, 10);
+                if (*end_ptr != '\0')
+                {
+                    fprintf(stderr, "bad wavetable size.\n");
+                    return 1;
+                }
+            }
+        }
+        else if (strcmp(argv[i], "-voices") == 0 && i + 1 < argc)
+        {
+            char *end_ptr = NULL;
+            voices_count = strtol(argv[++i], &end_ptr, 10);
+            if (*end_ptr != '\0' || voices_count < MIN_VOICES || voices_count > MAX_VOICES)
+            {
+                fprintf(stderr, "bad voices count, must be between %d and %d.\n", MIN_VOICES, MAX_VOICES);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+        {
+            char *end_ptr = NULL;
+            threads = strtol(argv[++i], &end_ptr, 10);
+            if (*end_ptr != '\0' || threads < 0 || threads > POOL_MAX_THREADS)
+            {
+                fprintf(stderr, "bad threads count, must be between 0 and %d.\n", POOL_MAX_THREADS);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-control-rate") == 0 && i + 1 < argc)
+        {
+            char *end_ptr = NULL;
+            control_rate = strtol(argv[++i], &end_ptr, 10);
+            if (*end_ptr != '\0' || control_rate < MIN_CONTROL_RATE || control_rate > MAX_CONTROL_RATE)
+            {
+                fprintf(stderr, "bad control rate, must be between %d and %d samples.\n", MIN_CONTROL_RATE, MAX_CONTROL_RATE);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-simd") == 0 && i + 1 < argc)
+        {
+            simd = argv[++i];
+        }
+        else if (strcmp(argv[i], "-rate") == 0 && i + 1 < argc)
+        {
+            static const int rates[] = SAMPLE_RATES;
+            char *end_ptr = NULL;
+            rate = strtol(argv[++i], &end_ptr, 10);
+            bool supported = false;
+            for (int r = 0; r < (int)(sizeof(rates) / sizeof(rates[0])); r++)
+            {
+                supported = supported || rate == rates[r];
+            }
+            if (*end_ptr != '\0' || !supported)
+            {
+                fprintf(stderr, "bad sample rate, must be 44100, 48000, 96000 or 192000.\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-period") == 0 && i + 1 < argc)
+        {
+            char *end_ptr = NULL;
+            period = strtol(argv[++i], &end_ptr, 10);
+            if (*end_ptr != '\0' || period < MIN_PERIOD || period > FRAMES)
+            {
+                fprintf(stderr, "bad period, must be between %d and %d frames.\n", MIN_PERIOD, FRAMES);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-periods") == 0 && i + 1 < argc)
+        {
+            char *end_ptr = NULL;
+            periods = strtol(argv[++i], &end_ptr, 10);
+            if (*end_ptr != '\0' || periods < MIN_PERIODS || periods > MAX_PERIODS)
+            {
+                fprintf(stderr, "bad periods count, must be between %d and %d.\n", MIN_PERIODS, MAX_PERIODS);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-low-latency") == 0)
+        {
+            period = LOW_LATENCY_PERIOD;
+            periods = LOW_LATENCY_PERIODS;
+        }
+        else if (strcmp(argv[i], "-realtime") == 0)
+        {
+            /* The priority is optional */
+            priority = REALTIME_PRIORITY;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                char *end_ptr = NULL;
+                priority = strtol(argv[++i], &end_ptr, 10);
+                if (*end_ptr != '\0' || priority < 1 || priority > 99)
+                {
+                    fprintf(stderr, "bad real-time priority, must be between 1 and 99.\n");
+                    return 1;
+                }
+            }
+        }
+        else if (strcmp(argv[i], "-stats") == 0 && i + 1 < argc)
+        {
+            stats_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "-cpu") == 0 && i + 1 < argc)
+        {
+            char *end_ptr = NULL;
+            cpu = strtol(argv[++i], &end_ptr, 10);
+            long cores = sysconf(_SC_NPROCESSORS_CONF);
+            if (*end_ptr != '\0' || cpu < 0 || cpu >= cores)
+            {
+                fprintf(stderr, "bad CPU core, must be between 0 and %ld.\n", cores - 1);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-steal") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "oldest") == 0)
+            {
+                steal_policy = STEAL_OLDEST;
+            }
+            else if (strcmp(argv[i], "quietest") == 0)
+            {
+                steal_policy = STEAL_QUIETEST;
+            }
+            else if (strcmp(argv[i], "released") == 0)
+            {
+                steal_policy = STEAL_RELEASED;
+            }
+            else
+            {
+                fprintf(stderr, "bad steal policy, must be oldest, quietest or released.\n");
+                return 1;
+            }
+        }
         else
         {
             usage();
@@ -49,133 +235,136 @@ int main(int argc, char **argv)
 
     int octave = DEFAULT_OCTAVE;
 
-    int wave_a = SINE_WAVE, wave_b = SINE_WAVE, wave_c = SINE_WAVE;
-    int osc_lfo = SINE_WAVE;
-
-    float attack = 0.2;
-    float decay = 0.3;
-    float sustain = 0.7;
-    float release = 0.2;
-
-    float filter_attack = 0.0;
-    float filter_decay = 0.3;
-    float filter_sustain = 0.0;
-    float filter_release = 0.2;
-
-    adsr_t filter_adsr =
+    /* Parameters edited by the GUI, sent to the audio thread at each frame */
+    synth_params_t params =
         {
-            .attack = &filter_attack,
-            .decay = &filter_decay,
-            .sustain = &filter_sustain,
-            .release = &filter_release};
+            .attack = 0.2,
+            .decay = 0.3,
+            .sustain = 0.7,
+            .release = 0.2,
+            .filter_attack = 0.0,
+            .filter_decay = 0.3,
+            .filter_sustain = 0.0,
+            .filter_release = 0.2,
+            .exp_env = false,
+            .cutoff = 0.5,
+            .filter_env = false,
+            .voice_filters = false,
+            .filter_type = ONE_POLE_FILTER,
+            .resonance = 0.0,
+            .waves = {SINE_WAVE, SINE_WAVE, SINE_WAVE},
+            .detune = 0.0,
+            .amp = DEFAULT_AMPLITUDE,
+            .pitch_bend = 0.0,
+            .glide = 0.0,
+            .lfo_wave = SINE_WAVE,
+            .lfo_param = LFO_OFF,
+            .lfo_freq = 0.5,
+            .arp = false,
+            .bpm = 150.0,
+            .distortion = false,
+            .overdrive = false,
+            .distortion_amount = 0.0};
+
+    static control_t control;
+    control_init(&control, &params);
 
     lp_filter_t filter =
         {
-            .cutoff = 0.5,
             .prev_input = 0.0,
             .prev_output = 0.0,
-            .adsr = &filter_adsr,
-            .env = false};
-
-    osc_t lfo_osc =
-        {
-            .freq = 0.5,
-            .phase = 0.0,
-            .wave = &osc_lfo};
+            .alpha = lp_alpha(params.cutoff, rate),
+            .cutoff = params.cutoff,
+            .target = lp_alpha(params.cutoff, rate),
+            .rate = rate};
 
     lfo_t lfo = 
         {
-            .osc = &lfo_osc,
-            .mod_param = LFO_OFF};
+            .phase = 0.0,
+            .value = 0.0};
     
-    synth_t synth =
-        {
-            .voices = malloc(sizeof(voice_t) * VOICES),
-            .amp = DEFAULT_AMPLITUDE,
-            .detune = 0.0,
-            .filter = &filter,
-            .lfo = &lfo,
-            .arp = false,
-            .active_arp = 0,
-            .active_arp_float = 1.0,
-            .bpm = 150.0};
+    pitch_init();
 
-    if (synth.voices == NULL)
+    /* The audio and MIDI paths never write to the terminal themselves */
+    if (rtlog_init(stderr) != 0)
     {
-        fprintf(stderr, "memory allocation failed.\n");
         return 1;
     }
 
-    /* Create the synth voices */
-    for (int i = 0; i < VOICES; i++)
+    if (dsp_init(simd) != 0)
     {
-        synth.voices[i].adsr = malloc(sizeof(adsr_t));
-        if (synth.voices[i].adsr == NULL)
-        {
-            fprintf(stderr, "memory allocation failed.\n");
-            for (int j = 0; j < i; j++)
-            {
-                free(synth.voices[j].adsr);
-                free(synth.voices[j].oscillators);
-            }
-            free(synth.voices);
-            return 1;
-        }
-
-        synth.voices[i].adsr->attack = &attack;
-        synth.voices[i].adsr->decay = &decay;
-        synth.voices[i].adsr->sustain = &sustain;
-        synth.voices[i].adsr->release = &release;
-        synth.voices[i].adsr->state = ENV_IDLE;
-        synth.voices[i].adsr->output = 0.0;
-
-        synth.voices[i].note = -1;
-        synth.voices[i].velocity_amp = 0.0;
-        synth.voices[i].pressed = 0;
-
-        synth.voices[i].oscillators = malloc(sizeof(osc_t) * 3);
-        if (synth.voices[i].oscillators == NULL)
-        {
-            fprintf(stderr, "memory allocation failed.\n");
-            goto cleanup_synth;
-        }
+        rtlog_free();
+        return 1;
+    }
+    fprintf(stderr, "using the %s DSP kernels.\n", dsp_simd_name());
 
-        for (int j = 0; j < 3; j++)
-        {
-            synth.voices[i].oscillators[j].freq = 0.0;
-            synth.voices[i].oscillators[j].phase = 0.0;
-        }
-        synth.voices[i].oscillators[0].wave = &wave_a;
-        synth.voices[i].oscillators[1].wave = &wave_b;
-        synth.voices[i].oscillators[2].wave = &wave_c;
+    wavetables_t wavetables = {0};
+    if (wavetable_size > 0 && wavetables_init(&wavetables, wavetable_size, rate) != 0)
+    {
+        rtlog_free();
+        return 1;
     }
 
-    snd_pcm_t *handle = NULL;
-    if (snd_pcm_open(&handle, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0)
+    voices_t voices;
+    if (voices_init(&voices, voices_count) != 0)
     {
-        fprintf(stderr, "error while opening sound card.\n");
-        goto cleanup_synth;
+        fprintf(stderr, "memory allocation failed.\n");
+        wavetables_free(&wavetables);
+        rtlog_free();
+        return 1;
     }
 
-    int params_err = snd_pcm_set_params(
-        handle,
-        SND_PCM_FORMAT_S16_LE,
-        SND_PCM_ACCESS_RW_INTERLEAVED,
-        MONO, RATE, 1, LATENCY);
+    voices.steal_policy = steal_policy;
 
-    if (params_err < 0)
+    static pool_t pool;
+    if (threads > 0 && pool_init(&pool, threads) != 0)
     {
-        fprintf(stderr, "error while setting sound card parameters: %s\n", snd_strerror(params_err));
-        goto cleanup_alsa;
+        voices_free(&voices);
+        wavetables_free(&wavetables);
+        rtlog_free();
+        return 1;
     }
 
-    snd_pcm_prepare(handle);
+    synth_t synth =
+        {
+            .voices = &voices,
+            .wavetables = (wavetable_size > 0) ? &wavetables : NULL,
+            .pool = (threads > 0) ? &pool : NULL,
+            .params = NULL,
+            .detune = 0.0,
+            .pitch_bend = 0.0,
+            .bend = 1.0,
+            .last_pitch = -1.0,
+            .gliding = 0,
+            .filter = &filter,
+            .lfo = &lfo,
+            .active_arp = 0,
+            .active_arp_float = 1.0,
+            .rate = rate,
+            .control_rate = control_rate};
 
-    short buffer[FRAMES];
-    memset(buffer, 0, sizeof(short) * FRAMES);
-    snd_pcm_writei(handle, buffer, FRAMES);
+    static record_ring_t record_ring;
+    audio_t audio =
+        {
+            .rate = rate,
+            .period = period,
+            .periods = periods,
+            .priority = priority,
+            .cpu = cpu,
+            .synth = &synth,
+            .control = &control,
+            .record = &record_ring};
+
+    if (audio_open(&audio) != 0)
+    {
+        goto cleanup_alsa;
+    }
+    fprintf(stderr, "playing at %d Hz, %d periods of %d frames (%.1f ms of latency), %s access.\n",
+            audio.rate, audio.periods, audio.period,
+            1000.0 * audio.periods * audio.period / audio.rate,
+            audio.mmap ? "memory mapped" : "read and write");
 
-    snd_rawmidi_t *midi_in;
+    snd_rawmidi_t *midi_in = NULL;
     if (midi_input)
     {
         if (snd_rawmidi_open(&midi_in, NULL, midi_device, SND_RAWMIDI_NONBLOCK) < 0)
@@ -191,88 +380,118 @@ int main(int argc, char **argv)
     wav_header_t header;
     unsigned int count = 0;
     bool recording = false;
+    short record_buffer[FRAMES];
 
     /* Oscillators dropdown menus booleans */
     bool ddm_a = false, ddm_b = false, ddm_c = false;
     bool saving_preset = false, saving_audio_file = false, loading_preset = false;
     bool lfo_wave_ddm = false, lfo_params_ddm = false;
-    bool distortion_on = false, overdrive = false;
-    float distortion_amount = 0.0;
-    int active_voices = 0;
+    bool filter_ddm = false;
 
     char preset_filename[1024] = "\0";
 
     InitWindow(WIDTH, HEIGHT, "ALSA & raygui synthesizer");
+    SetTargetFPS(FPS);
     Font annotation = LoadFont("Regular.ttf");
     GuiSetFont(annotation);
     GuiSetStyle(DEFAULT, TEXT_SIZE, GuiGetFont().baseSize * 0.5);
 
-    while (!WindowShouldClose())
+    /* The MIDI thread sends the notes to the audio thread as soon as they arrive */
+    static midi_t midi;
+    if (midi_input && midi_start(&midi, midi_in, &control) != 0)
     {
-        if (!saving_preset && !saving_audio_file)
+        CloseWindow();
+        goto cleanup_midi;
+    }
+
+    /*
+     * The workers render within the deadline of the audio thread, just under its priority,
+     * so that it always gets its core back when they are done
+     * The MIDI thread mostly sleeps, it runs just under it too so that a note is never late
+     */
+    if (priority > 0)
+    {
+        realtime_lock_memory();
+        for (int w = 0; w < threads; w++)
         {
-            handle_input(&synth, &octave);
-            handle_release(&synth, octave);
+            realtime_thread(pool.threads[w], priority - 1, -1);
         }
-
         if (midi_input)
         {
-            get_midi(midi_in, &synth, &attack, &decay, &sustain, &release);
+            realtime_thread(midi.thread, priority - 1, -1);
         }
+    }
 
-        for (int v = 0; v < VOICES; v++)
-        {
-            if (synth.voices[v].adsr->state != ENV_IDLE)
-            {
-                active_voices++;
-            }
-        }
-            
-        for (int i = 0; i < FRAMES; i++)
+    /* The audio thread renders and plays the synth from now on */
+    if (audio_start(&audio) != 0)
+    {
+        CloseWindow();
+        goto cleanup_midi;
+    }
+
+    if (stats_file != NULL)
+    {
+        struct sigaction action = {.sa_handler = request_stats, .sa_flags = SA_RESTART};
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR1, &action, NULL);
+    }
+
+    while (!WindowShouldClose())
+    {
+        if (dump_stats)
         {
-            process_lfo(&synth);
-            double sample = process_voices(&synth);
-            sample = process_gain(synth, sample, active_voices);
-            sample = process_filter(&synth, sample);
-            buffer[i] = (short)(sample * 32767.0);
-            if (distortion_on)
-            {
-                buffer[i] = distortion(buffer[i], distortion_amount, overdrive);
-            }
-            process_arpeggiator(&synth, active_voices);
+            dump_stats = 0;
+            stats_dump(&audio.stats, stats_file);
         }
 
-        active_voices = 0;
-            
-        int err = snd_pcm_writei(handle, buffer, FRAMES);
-        if (err == -EPIPE)
+        if (!saving_preset && !saving_audio_file)
         {
-            fprintf(stderr, "ALSA underrun!\n");
-            snd_pcm_prepare(handle);
+            handle_input(&control, &octave);
+            handle_release(&control, octave);
         }
-        else if (err < 0)
+
+        if (midi_input)
         {
-            fprintf(stderr, "ALSA write error: %s\n", snd_strerror(err));
-            snd_pcm_prepare(handle);
+            midi_apply(&midi, &params);
         }
 
+        /* Writing the samples recorded by the audio thread into the WAV file */
         if (fwav != NULL && recording == true)
         {
-            fwrite(buffer, 2, FRAMES, fwav);
-            count++;
+            unsigned int popped;
+            while ((popped = record_ring_pop(&record_ring, record_buffer, FRAMES)) > 0)
+            {
+                fwrite(record_buffer, 2, popped, fwav);
+                count += popped;
+            }
         }
         else if (fwav == NULL && recording == true)
         {
             char audio_full_filename[1024] = "audio/";
             strcat(audio_full_filename, audio_filename);
             strcat(audio_full_filename, ".wav");
-            init_wav_header(&header);
+            init_wav_header(&header, audio.rate);
             init_wav_file(audio_full_filename, &fwav, &header);
             audio_filename[0] = '\0';
+
+            /* The blocks pushed after the previous recording stopped don't belong to this one */
+            while (record_ring_pop(&record_ring, record_buffer, FRAMES) > 0)
+            {
+            }
+            atomic_store(&audio.recording, fwav != NULL);
         }
         else if (fwav != NULL && recording == false)
         {
-            header.sub2_size = FRAMES * count * (unsigned int)header.num_channels * (unsigned int)header.bits_per_sample / 8;
+            atomic_store(&audio.recording, false);
+
+            /* Writing the samples recorded since the last frame before closing the file */
+            unsigned int popped;
+            while ((popped = record_ring_pop(&record_ring, record_buffer, FRAMES)) > 0)
+            {
+                fwrite(record_buffer, 2, popped, fwav);
+                count += popped;
+            }
+            header.sub2_size = count * (unsigned int)header.num_channels * (unsigned int)header.bits_per_sample / 8;
             header.chunk_size = (unsigned int)header.sub2_size + 36;
             fseek(fwav, 0, SEEK_SET);
             fwrite(&header, 1, sizeof(header), fwav);
@@ -285,111 +504,114 @@ int main(int argc, char **argv)
 
             ClearBackground(GetColor(GuiGetStyle(DEFAULT, BACKGROUND_COLOR)));
             GuiLabel((Rectangle){WIDTH / 2 - 115, 5, 230, 20}, "ALSA & raygui Synthesizer");
-            
-            render_waveform(buffer);
-            render_adsr(&attack, &decay, &sustain, &release);
-            render_filter_adsr(&synth);
+
+            /* Newest state of the synth rendered by the audio thread */
+            const synth_display_t *display = control_acquire_display(&control);
+
+            render_waveform(display->scope);
+            render_adsr(&params.attack, &params.decay, &params.sustain, &params.release,
+                        &params.exp_env);
+            render_filter_adsr(&params);
             render_osc_waveforms(
-                &wave_a, &wave_b, &wave_c,
+                &params.waves[0], &params.waves[1], &params.waves[2],
                 &ddm_a, &ddm_b, &ddm_c);
-            render_synth_params(&synth);
+            render_synth_params(&params, display, &filter_ddm);
             render_options(
-                &synth,
+                &control, &params,
                 audio_filename,
                 &saving_preset, &loading_preset, 
                 &saving_audio_file, &recording);
             render_effects(
-                &synth,
-                &lfo_wave_ddm, &lfo_params_ddm,
-                &distortion_on, &overdrive,
-                &distortion_amount);
+                &params,
+                &lfo_wave_ddm, &lfo_params_ddm);
 
-            if (loading_preset)
-            {
-                load_preset(
-                    &synth,
-                    &attack, &decay, &sustain, &release,
-                    &wave_a, &wave_b, &wave_c,
-                    &distortion_on, &overdrive, 
-                    &distortion_amount, 
-                    &loading_preset);
-            }
-                
-            if (saving_preset)
-            {
-                save_preset(
-                    synth,
-                    attack, decay, sustain, release,
-                    wave_a, wave_b, wave_c,
-                    preset_filename, &saving_preset, 
-                    distortion_on, overdrive,
-                    distortion_amount);
-            }
-                
             render_white_keys();
-            for (int v = 0; v < VOICES; v++)
+            for (int n = 0; n < MIDI_NOTES; n++)
             {
-                if (synth.voices[v].pressed && !is_black_key(synth.voices[v].note))
+                if (display->pressed[n] && !is_black_key(n))
                 {
-                    render_key(synth.voices[v].note, false);
+                    render_key(n, false);
                 }
             }
-            if (synth.arp && 
-                !is_black_key(synth.voices[synth.active_arp].note) &&
-                synth.voices[synth.active_arp].pressed)
+            if (display->arp_note != -1 && !is_black_key(display->arp_note))
             {
-                render_key(synth.voices[synth.active_arp].note, true);
+                render_key(display->arp_note, true);
             }
 
             render_black_keys();
-            for (int v = 0; v < VOICES; v++)
+            for (int n = 0; n < MIDI_NOTES; n++)
             {
-                if (synth.voices[v].pressed && is_black_key(synth.voices[v].note))
+                if (display->pressed[n] && is_black_key(n))
                 {
-                    render_key(synth.voices[v].note, false);
+                    render_key(n, false);
                 }
             }
-            if (synth.arp && 
-                is_black_key(synth.voices[synth.active_arp].note) &&
-                synth.voices[synth.active_arp].pressed)
+            if (display->arp_note != -1 && is_black_key(display->arp_note))
             {
-                render_key(synth.voices[synth.active_arp].note, true);
+                render_key(display->arp_note, true);
+            }
+
+            /*
+             * The presets are read and written on the parameters owned by this thread,
+             * the audio thread only sees them as a whole once they are published below
+             */
+            if (loading_preset)
+            {
+                load_preset(&params, &loading_preset);
             }
                 
+            if (saving_preset)
+            {
+                save_preset(&params, preset_filename, &saving_preset);
+            }
     
         EndDrawing();
+
+        /* The audio thread takes the parameters of this frame at its next block */
+        control_publish_params(&control, &params);
     }
 
     CloseWindow();
 
-    if (midi_in)
+    audio_stop(&audio);
+
+    if (stats_file != NULL)
     {
-        snd_rawmidi_close(midi_in);
+        stats_dump(&audio.stats, stats_file);
     }
 
     /* If we quit the application during recording, change WAV header and close WAV file */
     if (fwav != NULL && recording)
     {
-        header.sub2_size = FRAMES * count * (unsigned int)header.num_channels * (unsigned int)header.bits_per_sample / 8;
+        unsigned int popped;
+        while ((popped = record_ring_pop(&record_ring, record_buffer, FRAMES)) > 0)
+        {
+            fwrite(record_buffer, 2, popped, fwav);
+            count += popped;
+        }
+        header.sub2_size = count * (unsigned int)header.num_channels * (unsigned int)header.bits_per_sample / 8;
         header.chunk_size = (unsigned int)header.sub2_size + 36;
         fseek(fwav, 0, SEEK_SET);
         fwrite(&header, 1, sizeof(header), fwav);
         close_wav_file(fwav);
     }
 
-cleanup_alsa:
-    if (handle)
+cleanup_midi:
+    midi_stop(&midi);
+    if (midi_in)
     {
-        snd_pcm_drain(handle);
-        snd_pcm_close(handle);
+        snd_rawmidi_close(midi_in);
     }
-cleanup_synth:
-    for (int i = 0; i < VOICES; i++)
+
+cleanup_alsa:
+    audio_close(&audio);
+    if (threads > 0)
     {
-        free(synth.voices[i].adsr);
-        free(synth.voices[i].oscillators);
+        pool_free(&pool);
     }
-    free(synth.voices);
+    voices_free(&voices);
+    wavetables_free(&wavetables);
+    rtlog_free();
 
     return 0;
 }
@@ -1,27 +1,29 @@
 #include <alsa/asoundlib.h>
 
 #include "defs.h"
-#include "synth.h"
+#include "control.h"
 #include "midi.h"
+#include "realtime.h"
+#include "rtlog.h"
 
 /*
  * Get the MIDI input from the ALSA RawMIDI input (snd_rawmidi_t)
- * Activate the synth voices and update their frequencies with the given note
- * Turn off the synth voices when their assigned note are being released
- * Change the ADSR parameters when the assigned knobs are being triggered
- * Change the cutoff, detune and amplification when the assigned knobs are being triggered
+ * Send the pressed and released notes to the audio thread
+ * Keep the last values of the knobs and the pitch wheel for the GUI thread
  */
-int get_midi(snd_rawmidi_t *midi_in, synth_t *synth,
-             float *attack, float *decay, float *sustain, float *release)
-{   
+static int read_midi(midi_t *midi)
+{
     unsigned char midi_buffer[1024];
-    ssize_t ret = snd_rawmidi_read(midi_in, midi_buffer, sizeof(midi_buffer));
+    ssize_t ret = snd_rawmidi_read(midi->in, midi_buffer, sizeof(midi_buffer));
 
     if (ret < 0)
     {
+        if (ret != -EAGAIN)
+        {
+            rtlog("MIDI read error: %d\n", (int)ret);
+        }
         return 1;
     }
-        
 
     for (int i = 0; i + 2 < ret; i += 3)
     {   /* Getting the MIDI bytes informations */
@@ -29,119 +31,150 @@ int get_midi(snd_rawmidi_t *midi_in, synth_t *synth,
         unsigned char data1 = midi_buffer[i + 1];
         unsigned char data2 = midi_buffer[i + 2];
 
-        if ((status & PRESSED) == NOTE_ON && data2 > 0)
+        /* The data bytes are 7 bits, a real-time byte in between would give notes past 127 */
+        if ((data1 | data2) & 0x80)
         {
-            int pressed_voices = 0;
-
-            for (int v = 0; v < VOICES; v++)
-            {   
-                if (synth->voices[v].pressed)
-                {
-                    pressed_voices++;
-                }
-                
-                if (synth->voices[v].adsr->state == ENV_RELEASE && !synth->arp)
-                {
-                    synth->voices[v].adsr->state = ENV_IDLE;
-                }
-            }
-
-            voice_t *free_voice = get_free_voice(synth);
-            if (free_voice == NULL)
-            {
-                continue;
-            }   
-            free_voice->pressed = 1;
-            change_freq(free_voice, data1, data2, synth->detune);
-            if (pressed_voices == 0 && synth->filter->env)
-            {
-                synth->filter->adsr->state = ENV_ATTACK;
-            }
-                
+            continue;
+        }
 
-            if (synth->arp)
+        if ((status & PRESSED) == NOTE_ON && data2 > 0)
+        {
+            if (control_push_midi_event(midi->control, EVENT_NOTE_ON, data1, data2) != 0)
             {
-                sort_synth_voices(synth);
-                if (pressed_voices == 0)
-                {
-                    synth->active_arp_float = 1.0;
-                }
+                rtlog("note events queue full, note on %d dropped\n", data1);
             }
         }
         else if ((status & PRESSED) == NOTE_OFF ||
                  ((status & PRESSED) == NOTE_ON && data2 == 0))
         {
-            int pressed_voices = 0;
-            for (int v = 0; v < VOICES; v++)
-            {
-                if (synth->voices[v].pressed)
-                {
-                    pressed_voices++;
-                }
-            }
-            
-            for (int v = 0; v < VOICES; v++)
-            {
-                if (synth->voices[v].note == data1 && 
-                    synth->voices[v].pressed)
-                {
-                    if (synth->arp && synth->voices[v].adsr->state != ENV_IDLE)
-                    {
-                        synth->voices[v].adsr->state = ENV_IDLE;
-                    }
-                    else if (!synth->arp &&
-                            synth->voices[v].adsr->state != ENV_RELEASE &&
-                            synth->voices[v].adsr->state != ENV_IDLE)
-                    {
-                        synth->voices[v].adsr->state = ENV_RELEASE;
-                    }
-                        
-                    synth->voices[v].note = -1;
-                    synth->voices[v].pressed = 0;
-
-                    break; 
-                }
-            }
-
-            if (synth->arp)
+            if (control_push_midi_event(midi->control, EVENT_NOTE_OFF, data1, 0) != 0)
             {
-                sort_synth_voices(synth);
-                if (pressed_voices == 2)
-                {
-                    synth->active_arp_float = 1.0;
-                }
+                rtlog("note events queue full, note off %d dropped\n", data1);
             }
         }
+        else if ((status & PRESSED) == PITCH_BEND)
+        {   /* 14 bits value, least significant bits first */
+            atomic_store(&midi->pitch_bend, (data2 << 7) | data1);
+        }
         else if ((status & PRESSED) == KNOB_TURNED)
         {
-            switch (data1)
-            {
-            case ARTURIA_ATT_KNOB:
-                *attack = ((float)data2 / MIDI_MAX_VALUE) * 2.0;
-                break;
-            case ARTURIA_DEC_KNOB:
-                *decay = ((float)data2 / MIDI_MAX_VALUE) * 2.0;
-                break;
-            case ARTURIA_SUS_KNOB:
-                *sustain = (float)data2 / MIDI_MAX_VALUE;
-                break;
-            case ARTURIA_REL_KNOB:
-                *release = ((float)data2 / MIDI_MAX_VALUE) * 1.0;
-                break;
-            case ARTURIA_CUTOFF_KNOB:
-                synth->filter->cutoff = ((float)data2 / MIDI_MAX_VALUE);
-                break;
-            case ARTURIA_DETUNE_KNOB:
-                synth->detune = ((float)data2 / MIDI_MAX_VALUE);
-                apply_detune_change(synth);
-                break;
-            case ARTURIA_AMPLITUDE_KNOB:
-                synth->amp = ((float)data2 / MIDI_MAX_VALUE) * 1.0;
-                break;
-            default:
-                break;
-            }
+            atomic_store(&midi->knobs[data1], data2);
         }
     }
     return 0;
-}
\ No newline at end of file
+}
+
+/* MIDI thread main loop, reads the input each time the poll descriptors wake it up */
+static void *midi_thread(void *arg)
+{
+    midi_t *midi = arg;
+
+    while (atomic_load(&midi->running))
+    {
+        int ready = poll(midi->fds, midi->nfds, MIDI_POLL_TIMEOUT);
+        if (ready < 0 && errno != EINTR)
+        {
+            rtlog("MIDI poll error: errno %d\n", errno);
+            break;
+        }
+        if (ready > 0)
+        {
+            read_midi(midi);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Start the MIDI thread reading the ALSA RawMIDI input (snd_rawmidi_t)
+ * Returns 1 if the poll descriptors can't be read or the thread couldn't be created
+ */
+int midi_start(midi_t *midi, snd_rawmidi_t *in, control_t *control)
+{
+    midi->in = in;
+    midi->control = control;
+    for (int k = 0; k < MIDI_CONTROLLERS; k++)
+    {
+        atomic_init(&midi->knobs[k], -1);
+    }
+    atomic_init(&midi->pitch_bend, -1);
+
+    int count = snd_rawmidi_poll_descriptors_count(in);
+    if (count <= 0 || count > MIDI_POLL_FDS)
+    {
+        fprintf(stderr, "error while getting the MIDI poll descriptors.\n");
+        return 1;
+    }
+    midi->nfds = snd_rawmidi_poll_descriptors(in, midi->fds, count);
+
+    atomic_store(&midi->running, true);
+    if (realtime_create(&midi->thread, midi_thread, midi) != 0)
+    {
+        fprintf(stderr, "error while creating the MIDI thread.\n");
+        atomic_store(&midi->running, false);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Stop the MIDI thread and wait for it to finish */
+void midi_stop(midi_t *midi)
+{
+    if (atomic_exchange(&midi->running, false))
+    {
+        pthread_join(midi->thread, NULL);
+    }
+}
+
+/*
+ * Apply the knobs and the pitch wheel moved since the last call to the parameters :
+ * - ADSR parameters
+ * - Cutoff, detune and amplification
+ * - Pitch bend
+ */
+void midi_apply(midi_t *midi, synth_params_t *params)
+{
+    int bend = atomic_exchange(&midi->pitch_bend, -1);
+    if (bend != -1)
+    {
+        params->pitch_bend = (float)(bend - PITCH_BEND_CENTER) / PITCH_BEND_CENTER;
+    }
+
+    for (int k = 0; k < MIDI_CONTROLLERS; k++)
+    {
+        int value = atomic_exchange(&midi->knobs[k], -1);
+        if (value == -1)
+        {
+            continue;
+        }
+
+        switch (k)
+        {
+        case ARTURIA_ATT_KNOB:
+            params->attack = ((float)value / MIDI_MAX_VALUE) * 2.0;
+            break;
+        case ARTURIA_DEC_KNOB:
+            params->decay = ((float)value / MIDI_MAX_VALUE) * 2.0;
+            break;
+        case ARTURIA_SUS_KNOB:
+            params->sustain = (float)value / MIDI_MAX_VALUE;
+            break;
+        case ARTURIA_REL_KNOB:
+            params->release = ((float)value / MIDI_MAX_VALUE) * 1.0;
+            break;
+        case ARTURIA_CUTOFF_KNOB:
+            params->cutoff = ((float)value / MIDI_MAX_VALUE);
+            break;
+        case ARTURIA_DETUNE_KNOB:
+            params->detune = ((float)value / MIDI_MAX_VALUE);
+            break;
+        case ARTURIA_AMPLITUDE_KNOB:
+            params->amp = ((float)value / MIDI_MAX_VALUE) * 1.0;
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "defs.h"
+#include "pitch.h"
+
+static float note_table[MIDI_NOTES];
+
+/* Build the frequency table of the MIDI notes, called once at startup */
+void pitch_init(void)
+{
+    for (int n = 0; n < MIDI_NOTES; n++)
+    {
+        note_table[n] = A_4 * pow(2, (n - A4_POSITION) / 12.0);
+    }
+}
+
+/*
+ * Returns the frequency of a MIDI note (0 to 127) from the table
+ * The notes outside the MIDI range are clamped to it
+ */
+float note_freq(int note)
+{
+    if (note < 0)
+    {
+        note = 0;
+    }
+    else if (note >= MIDI_NOTES)
+    {
+        note = MIDI_NOTES - 1;
+    }
+    return note_table[note];
+}
+
+/*
+ * Fast 2^x approximation, for the continuous pitch modulations
+ * The relative error is below 3e-6, about 0.005 cent
+ * x must be between -126 and 127
+ */
+float fast_exp2(float x)
+{
+    /* 2^x = 2^floor(x) * 2^fraction, the fraction by a minimax polynomial */
+    float whole = floorf(x);
+    float fraction = x - whole;
+    float power = 1.0f + fraction * (0.693043993f + fraction * (0.241282807f +
+                  fraction * (0.0522406428f + fraction * 0.0134267094f)));
+
+    /* The power of two is built directly in the float exponent */
+    int32_t bits = ((int32_t)whole + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+
+    return power * scale;
+}
+
+/* Returns the frequency ratio of an interval in cents */
+float cents_ratio(float cents)
+{
+    return fast_exp2(cents / 1200.0f);
+}
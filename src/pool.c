@@ -0,0 +1,145 @@
+#include "defs.h"
+#include "pool.h"
+#include "realtime.h"
+
+#define CLAIM_JOBS_SHIFT 16
+#define CLAIM_INDEX_MASK 0xFFFF
+
+/* Claim and run the jobs of the current batch until none is left */
+static void pool_work(pool_t *pool)
+{
+    for (;;)
+    {
+        unsigned int claim = atomic_fetch_add_explicit(&pool->claim, 1, memory_order_acq_rel);
+        int jobs = claim >> CLAIM_JOBS_SHIFT;
+        int job = claim & CLAIM_INDEX_MASK;
+        if (job >= jobs)
+        {
+            return;
+        }
+
+        pool->job(pool->arg, job);
+        if (atomic_fetch_add_explicit(&pool->done, 1, memory_order_acq_rel) + 1 == jobs)
+        {
+            sem_post(&pool->finished);
+        }
+    }
+}
+
+/* Worker thread main loop, waits for a batch then helps with its jobs */
+static void *pool_thread(void *arg)
+{
+    pool_worker_t *worker = arg;
+    pool_t *pool = worker->pool;
+
+    /* The workers render within the audio deadline, their stack can't page fault either */
+    realtime_prefault_stack();
+
+    for (;;)
+    {
+        sem_wait(&pool->wake[worker->index]);
+        if (!atomic_load(&pool->running))
+        {
+            break;
+        }
+        pool_work(pool);
+    }
+
+    return NULL;
+}
+
+/*
+ * Start a pool of worker threads
+ * Returns 1 if a thread couldn't be created
+ */
+int pool_init(pool_t *pool, int count)
+{
+    if (count > POOL_MAX_THREADS)
+    {
+        count = POOL_MAX_THREADS;
+    }
+
+    pool->count = 0;
+    pool->job = NULL;
+    pool->arg = NULL;
+    atomic_store(&pool->running, true);
+    atomic_store(&pool->claim, 0);
+    atomic_store(&pool->done, 0);
+    sem_init(&pool->finished, 0, 0);
+
+    for (int w = 0; w < count; w++)
+    {
+        pool->workers[w].pool = pool;
+        pool->workers[w].index = w;
+        sem_init(&pool->wake[w], 0, 0);
+
+        if (realtime_create(&pool->threads[w], pool_thread, &pool->workers[w]) != 0)
+        {
+            fprintf(stderr, "error while creating the worker threads.\n");
+            sem_destroy(&pool->wake[w]);
+            pool_free(pool);
+            return 1;
+        }
+        pool->count++;
+    }
+
+    return 0;
+}
+
+/* Stop the worker threads and wait for them to finish */
+void pool_free(pool_t *pool)
+{
+    atomic_store(&pool->running, false);
+    for (int w = 0; w < pool->count; w++)
+    {
+        sem_post(&pool->wake[w]);
+    }
+    for (int w = 0; w < pool->count; w++)
+    {
+        pthread_join(pool->threads[w], NULL);
+        sem_destroy(&pool->wake[w]);
+    }
+    sem_destroy(&pool->finished);
+    pool->count = 0;
+}
+
+/*
+ * Run a batch of jobs and wait for all of them to be done
+ * Never allocates nor locks, the jobs run in the caller if the pool is NULL
+ * The caller claims the jobs left, then sleeps until the running ones are done
+ */
+void pool_run(pool_t *pool, int jobs, pool_job_t job, void *arg)
+{
+    if (pool == NULL || pool->count == 0 || jobs <= 1)
+    {
+        for (int j = 0; j < jobs; j++)
+        {
+            job(arg, j);
+        }
+        return;
+    }
+
+    /* Publishing the batch, the claim store releases the job and its argument */
+    pool->job = job;
+    pool->arg = arg;
+    atomic_store_explicit(&pool->done, 0, memory_order_relaxed);
+    atomic_store_explicit(&pool->claim, (unsigned int)jobs << CLAIM_JOBS_SHIFT, memory_order_release);
+
+    int workers = jobs - 1;
+    if (workers > pool->count)
+    {
+        workers = pool->count;
+    }
+    for (int w = 0; w < workers; w++)
+    {
+        sem_post(&pool->wake[w]);
+    }
+
+    pool_work(pool);
+
+    /* The remaining jobs are already running on the workers, the last one posts */
+    while (sem_wait(&pool->finished) != 0)
+    {
+        /* Interrupted by a signal */
+    }
+}
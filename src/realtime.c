@@ -0,0 +1,114 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "defs.h"
+#include "realtime.h"
+
+/*
+ * Create a thread with a stack of REALTIME_THREAD_STACK bytes
+ * Returns the pthread_create error, 0 if the thread was created
+ */
+int realtime_create(pthread_t *thread, void *(*routine)(void *), void *arg)
+{
+    pthread_attr_t attr;
+    int err = pthread_attr_init(&attr);
+    if (err != 0)
+    {
+        return err;
+    }
+
+    err = pthread_attr_setstacksize(&attr, REALTIME_THREAD_STACK);
+    if (err == 0)
+    {
+        err = pthread_create(thread, &attr, routine, arg);
+    }
+    pthread_attr_destroy(&attr);
+
+    return err;
+}
+
+/*
+ * Move a thread to the SCHED_FIFO real-time scheduling with the given priority,
+ * if priority isn't 0, and pin it on the given CPU core, if cpu isn't -1
+ * Prints why if the permissions are missing
+ * Returns 1 if one of them couldn't be applied, the thread then keeps running without it
+ */
+int realtime_thread(pthread_t thread, int priority, int cpu)
+{
+    int failed = 0;
+
+    if (priority > 0)
+    {
+        struct sched_param param = {.sched_priority = priority};
+        int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (err == EPERM)
+        {
+            fprintf(stderr, "no permission for the real-time priority %d, "
+                            "it needs CAP_SYS_NICE or an rtprio limit in /etc/security/limits.conf.\n", priority);
+            failed = 1;
+        }
+        else if (err != 0)
+        {
+            fprintf(stderr, "error while setting the real-time priority %d: %s\n", priority, strerror(err));
+            failed = 1;
+        }
+    }
+
+    if (cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if (err != 0)
+        {
+            fprintf(stderr, "error while pinning a thread on the CPU %d: %s\n", cpu, strerror(err));
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
+
+/*
+ * Lock the current and future memory of the process in RAM, so that it never pages out
+ * Prints why if the permissions or the memlock limit are missing
+ * Returns 1 if the memory couldn't be locked
+ */
+int realtime_lock_memory(void)
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        if (errno == EPERM)
+        {
+            fprintf(stderr, "no permission to lock the memory, it needs CAP_IPC_LOCK.\n");
+        }
+        else if (errno == ENOMEM)
+        {
+            fprintf(stderr, "the memory is over the memlock limit, "
+                            "raise it with ulimit -l or a memlock limit in /etc/security/limits.conf.\n");
+        }
+        else
+        {
+            fprintf(stderr, "error while locking the memory: %s\n", strerror(errno));
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Touch the stack the calling thread may use, so that it doesn't page fault on it later */
+void realtime_prefault_stack(void)
+{
+    volatile char stack[REALTIME_STACK];
+    long page = sysconf(_SC_PAGESIZE);
+
+    for (size_t i = 0; i < sizeof(stack); i += page)
+    {
+        stack[i] = 0;
+    }
+}
@@ -1,8 +1,8 @@
 #include "record.h"
 #include "defs.h"
 
-/* Initialize wav header */
-int init_wav_header(wav_header_t *header)
+/* Initialize wav header for mono 16 bits samples at the sample rate */
+int init_wav_header(wav_header_t *header, int rate)
 {
 
     header->chunk_id[0] = 'R';
@@ -31,7 +31,7 @@ int init_wav_header(wav_header_t *header)
     header->chunk_size = (unsigned int) header->sub2_size + 36;
     header->sub1_size = 16;
     header->audio_format = 1;
-    header->sample_rate = RATE;
+    header->sample_rate = rate;
     header->byte_rate = 
         (unsigned int) header->sample_rate *
         (unsigned int) header->num_channels *
@@ -77,3 +77,51 @@ int close_wav_file(FILE *fwav)
     }
     return 0;
 }
+
+/*
+ * Push samples into the record ring buffer, never blocks
+ * Returns the number of samples pushed, lower than count if the ring is full
+ */
+unsigned int record_ring_push(record_ring_t *ring, const short *samples, unsigned int count)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned int space = RECORD_RING_SIZE - (head - tail);
+
+    if (count > space)
+    {
+        count = space;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        ring->data[(head + i) & (RECORD_RING_SIZE - 1)] = samples[i];
+    }
+
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+/*
+ * Pop up to count samples from the record ring buffer
+ * Returns the number of samples popped
+ */
+unsigned int record_ring_pop(record_ring_t *ring, short *samples, unsigned int count)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned int available = head - tail;
+
+    if (count > available)
+    {
+        count = available;
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        samples[i] = ring->data[(tail + i) & (RECORD_RING_SIZE - 1)];
+    }
+
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
@@ -0,0 +1,341 @@
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "defs.h"
+#include "rtlog.h"
+#include "realtime.h"
+
+/* Argument of a message, its type is given by its conversion in the format */
+typedef union
+{
+    long i;
+    double f;
+    const char *s;
+} rtlog_arg_t;
+
+/*
+ * Message slot of the ring buffer
+ * The sequence is the position the slot is free for,
+ * it is the position + 1 once the message at this position is written
+ */
+typedef struct
+{
+    atomic_uint sequence;
+    const char *format;
+    int count;
+    rtlog_arg_t args[RTLOG_ARGS];
+} rtlog_message_t;
+
+/*
+ * Multiple producers, single consumer ring buffer of messages
+ * The producers claim a position by moving the head with a compare and swap,
+ * the logging thread is the only one moving the tail
+ */
+static struct
+{
+    rtlog_message_t messages[RTLOG_MESSAGES];
+    atomic_uint head;
+    unsigned int tail;
+    atomic_uint dropped;
+    unsigned int reported;
+    atomic_bool running;
+    pthread_t thread;
+    FILE *stream;
+} logger;
+
+/*
+ * Find the next conversion of a format from p, skipping the %% escapes
+ * Returns a pointer on its % sign and sets end past its conversion character,
+ * is_long is set if it has the l length modifier
+ * Returns NULL if there is none left
+ */
+static const char *next_conversion(const char *p, const char **end, bool *is_long)
+{
+    for (; *p != '\0'; p++)
+    {
+        if (*p != '%')
+        {
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            p++;
+            continue;
+        }
+
+        /* Flags, width and precision, then the length modifier */
+        const char *c = p + 1;
+        while (*c != '\0' && strchr("-+ #0123456789.", *c) != NULL)
+        {
+            c++;
+        }
+        *is_long = false;
+        while (*c == 'l')
+        {
+            *is_long = true;
+            c++;
+        }
+        if (*c == '\0')
+        {
+            return NULL;
+        }
+
+        *end = c + 1;
+        return p;
+    }
+
+    return NULL;
+}
+
+/* Write the text of a format from p up to to, or its end if to is NULL, with the %% escapes */
+static void write_text(FILE *stream, const char *p, const char *to)
+{
+    for (; *p != '\0' && p != to; p++)
+    {
+        fputc(*p, stream);
+        if (p[0] == '%' && p[1] == '%')
+        {
+            p++;
+        }
+    }
+}
+
+/* Format a message into the log stream, a conversion at a time */
+static void write_message(FILE *stream, const rtlog_message_t *message)
+{
+    const char *p = message->format;
+
+    for (int a = 0; a < message->count; a++)
+    {
+        const char *end;
+        bool is_long;
+        const char *start = next_conversion(p, &end, &is_long);
+        write_text(stream, p, start);
+
+        char spec[RTLOG_SPEC];
+        int length = end - start;
+        if (length >= RTLOG_SPEC)
+        {
+            length = RTLOG_SPEC - 1;
+        }
+        memcpy(spec, start, length);
+        spec[length] = '\0';
+
+        const rtlog_arg_t *arg = &message->args[a];
+        switch (end[-1])
+        {
+        case 's':
+            fprintf(stream, spec, arg->s);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            fprintf(stream, spec, arg->f);
+            break;
+        default:
+            if (is_long)
+            {
+                fprintf(stream, spec, arg->i);
+            }
+            else
+            {
+                fprintf(stream, spec, (int)arg->i);
+            }
+            break;
+        }
+
+        p = end;
+    }
+
+    write_text(stream, p, NULL);
+}
+
+/* Write the messages pushed up to the first one not written yet */
+static void write_pending(void)
+{
+    for (;;)
+    {
+        rtlog_message_t *message = &logger.messages[logger.tail & (RTLOG_MESSAGES - 1)];
+        if (atomic_load_explicit(&message->sequence, memory_order_acquire) != logger.tail + 1)
+        {
+            break;
+        }
+        write_message(logger.stream, message);
+
+        /* The slot is free for the position a lap later */
+        atomic_store_explicit(&message->sequence, logger.tail + RTLOG_MESSAGES, memory_order_release);
+        logger.tail++;
+    }
+}
+
+/* Write the count of the messages dropped since the last report */
+static void report_dropped(void)
+{
+    unsigned int dropped = atomic_load(&logger.dropped);
+    if (dropped != logger.reported)
+    {
+        fprintf(logger.stream, "%u log messages dropped\n", dropped - logger.reported);
+        logger.reported = dropped;
+    }
+    fflush(logger.stream);
+}
+
+/*
+ * Logging thread main loop
+ * Writes the pending messages and the count of the dropped ones every RTLOG_FLUSH_MS,
+ * the last messages are written after it is stopped
+ */
+static void *rtlog_thread(void *arg)
+{
+    (void)arg;
+    struct timespec period = {.tv_sec = 0, .tv_nsec = RTLOG_FLUSH_MS * 1000000L};
+    bool running = true;
+
+    while (running)
+    {
+        running = atomic_load(&logger.running);
+
+        write_pending();
+        report_dropped();
+
+        if (running)
+        {
+            nanosleep(&period, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Start the logging thread, writing the messages into the stream
+ * Returns 1 if the thread couldn't be created
+ */
+int rtlog_init(FILE *stream)
+{
+    for (unsigned int m = 0; m < RTLOG_MESSAGES; m++)
+    {
+        atomic_store(&logger.messages[m].sequence, m);
+    }
+    atomic_store(&logger.head, 0);
+    logger.tail = 0;
+    logger.reported = atomic_load(&logger.dropped);
+    logger.stream = stream;
+
+    atomic_store(&logger.running, true);
+    if (realtime_create(&logger.thread, rtlog_thread, NULL) != 0)
+    {
+        fprintf(stderr, "error while creating the logging thread.\n");
+        atomic_store(&logger.running, false);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Stop the logging thread, after it wrote the pending messages
+ * The messages pushed after its last pass are written here,
+ * the ones still being written by their thread are counted as dropped
+ */
+void rtlog_free(void)
+{
+    if (atomic_exchange(&logger.running, false))
+    {
+        pthread_join(logger.thread, NULL);
+
+        write_pending();
+        unsigned int unfinished = atomic_load(&logger.head) - logger.tail;
+        atomic_fetch_add(&logger.dropped, unfinished);
+        report_dropped();
+    }
+}
+
+/*
+ * Push a message from any thread, never blocks, locks nor allocates
+ * The message is dropped and counted if the ring buffer is full or the thread isn't running
+ * Returns 1 if the message was dropped
+ */
+int rtlog(const char *format, ...)
+{
+    if (!atomic_load_explicit(&logger.running, memory_order_acquire))
+    {
+        atomic_fetch_add_explicit(&logger.dropped, 1, memory_order_relaxed);
+        return 1;
+    }
+
+    /* Claiming the slot of the head position */
+    unsigned int position = atomic_load_explicit(&logger.head, memory_order_relaxed);
+    rtlog_message_t *message;
+    for (;;)
+    {
+        message = &logger.messages[position & (RTLOG_MESSAGES - 1)];
+        int lap = (int)(atomic_load_explicit(&message->sequence, memory_order_acquire) - position);
+        if (lap == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&logger.head, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (lap < 0)
+        {   /* The slot still holds the message of the previous lap, the ring is full */
+            atomic_fetch_add_explicit(&logger.dropped, 1, memory_order_relaxed);
+            return 1;
+        }
+        else
+        {   /* Another producer took the position */
+            position = atomic_load_explicit(&logger.head, memory_order_relaxed);
+        }
+    }
+
+    /* Only the arguments are stored, the logging thread formats them */
+    message->format = format;
+    message->count = 0;
+
+    va_list args;
+    va_start(args, format);
+    const char *p = format;
+    const char *end;
+    bool is_long;
+    while (message->count < RTLOG_ARGS && (p = next_conversion(p, &end, &is_long)) != NULL)
+    {
+        rtlog_arg_t *arg = &message->args[message->count++];
+        switch (end[-1])
+        {
+        case 's':
+            arg->s = va_arg(args, const char *);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            arg->f = va_arg(args, double);
+            break;
+        default:
+            arg->i = is_long ? va_arg(args, long) : va_arg(args, int);
+            break;
+        }
+        p = end;
+    }
+    va_end(args);
+
+    atomic_store_explicit(&message->sequence, position + 1, memory_order_release);
+    return 0;
+}
+
+/* Returns the number of messages dropped since the start */
+unsigned int rtlog_dropped(void)
+{
+    return atomic_load(&logger.dropped);
+}
@@ -0,0 +1,104 @@
+#include "stats.h"
+#include "rtlog.h"
+
+/* Returns the bucket of a value, the higher buckets cover wider ranges */
+static int stats_bucket(unsigned int value)
+{
+    if (value < 2 * STATS_SUB_BUCKETS)
+    {
+        return value;
+    }
+
+    int shift = 31 - __builtin_clz(value) - STATS_SUB_BITS;
+    return STATS_SUB_BUCKETS * shift + (value >> shift);
+}
+
+/* Returns the lowest value of a bucket */
+static unsigned int stats_bucket_value(int bucket)
+{
+    if (bucket < 2 * STATS_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    int shift = bucket / STATS_SUB_BUCKETS - 1;
+    return (unsigned int)(bucket - STATS_SUB_BUCKETS * shift) << shift;
+}
+
+/* Add a value to a histogram, never blocks */
+void stats_add(stats_histogram_t *histogram, unsigned int value)
+{
+    /* Single writer, the readers only need each counter to be whole */
+    atomic_fetch_add_explicit(&histogram->counts[stats_bucket(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total, 1, memory_order_relaxed);
+    if (value > atomic_load_explicit(&histogram->max, memory_order_relaxed))
+    {
+        atomic_store_explicit(&histogram->max, value, memory_order_relaxed);
+    }
+}
+
+/* Returns the value under which the given ratio (0.0 to 1.0) of the histogram values are */
+unsigned int stats_percentile(const stats_histogram_t *histogram, double ratio)
+{
+    unsigned int total = atomic_load_explicit(&histogram->total, memory_order_relaxed);
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    unsigned int rank = (unsigned int)(ratio * total);
+    unsigned int seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++)
+    {
+        seen += atomic_load_explicit(&histogram->counts[b], memory_order_relaxed);
+        if (seen > rank)
+        {
+            return stats_bucket_value(b);
+        }
+    }
+
+    return atomic_load_explicit(&histogram->max, memory_order_relaxed);
+}
+
+/* Returns the microseconds elapsed since start on the monotonic clock */
+unsigned int stats_elapsed_us(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/* Write the p50, p99 and max of a histogram, divided by the scale */
+static void stats_write_histogram(FILE *file, const char *name,
+                                  const stats_histogram_t *histogram, double scale)
+{
+    fprintf(file, "%s : p50 %.2f, p99 %.2f, max %.2f\n", name,
+            stats_percentile(histogram, 0.5) / scale,
+            stats_percentile(histogram, 0.99) / scale,
+            atomic_load_explicit(&histogram->max, memory_order_relaxed) / scale);
+}
+
+/*
+ * Write the counters and the p50, p99 and max of the histograms into a file
+ * Returns 1 if the file couldn't be written
+ */
+int stats_dump(const audio_stats_t *stats, const char *fname)
+{
+    FILE *file = fopen(fname, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "error while opening the stats file %s\n", fname);
+        return 1;
+    }
+
+    fprintf(file, "periods : %u\n", atomic_load(&stats->periods));
+    fprintf(file, "xruns : %u\n", atomic_load(&stats->xruns));
+    fprintf(file, "write errors : %u\n", atomic_load(&stats->errors));
+    fprintf(file, "log messages dropped : %u\n", rtlog_dropped());
+    stats_write_histogram(file, "render time (us)", &stats->render, 1.0);
+    stats_write_histogram(file, "dsp load (%)", &stats->load, 100.0);
+    stats_write_histogram(file, "output delay (us)", &stats->delay, 1.0);
+
+    fclose(file);
+    return 0;
+}
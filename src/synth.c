@@ -3,371 +3,1126 @@
 
 #include "defs.h"
 #include "synth.h"
+#include "dsp.h"
+#include "pitch.h"
+#include "filter.h"
 
 /*
- * Process a sample from the ADSR envelope
- * Returns the envelope amplification coeficient
+ * Set an envelope segment going from the from level to the level in time seconds at the sample rate
+ * An exponential segment aims past the level by the overshoot ratio of its height,
+ * a linear one moves by the same amount at each sample
  */
-float adsr_process(adsr_t *adsr)
+static void adsr_segment(adsr_segment_t *segment, float from, float level,
+                         float time, int rate, bool exponential, float overshoot,
+                         env_state_t next)
 {
-    switch (adsr->state)
+    float height = fabsf(level - from);
+
+    segment->level = level;
+    segment->end = level;
+    segment->sign = (level >= from) ? 1.0f : -1.0f;
+    segment->next = next;
+
+    if (time <= 0.0f)
+    {   /* No time, the level is reached at the first sample */
+        segment->mul = 0.0f;
+        segment->add = level;
+    }
+    else if (exponential)
     {
-    case ENV_IDLE:
-        return 0.0;
-        break;
-    case ENV_ATTACK:
-        if (*adsr->attack > 0.0)
-        {   /* Increment the amplification by the attack amount */
-            double increment = 1.0 / (*adsr->attack * RATE);
-            adsr->output += increment;
-            if (adsr->output >= 1.0)
+        float target = level + segment->sign * overshoot * height;
+        segment->mul = expf(-logf((1.0f + overshoot) / overshoot) / (time * rate));
+        segment->add = target * (1.0f - segment->mul);
+    }
+    else
+    {
+        segment->mul = 1.0f;
+        segment->add = segment->sign * height / (time * rate);
+    }
+}
+
+/*
+ * Compute the envelope coefficients of the given ADSR parameters at the sample rate
+ * The segments are exponential if exponential is true, else linear
+ */
+void adsr_coefs_init(adsr_coefs_t *coefs,
+                     float attack, float decay,
+                     float sustain, float release,
+                     bool exponential, int rate)
+{
+    adsr_segment_t *segments = coefs->segments;
+    coefs->sustain = sustain;
+
+    adsr_segment(&segments[ENV_ATTACK], 0.0f, 1.0f, attack, rate,
+                 exponential, ENV_ATTACK_RATIO, ENV_DECAY);
+
+    /* Without sustain, the decay goes down to the release amount then releases */
+    if (sustain > 0.0f)
+    {
+        adsr_segment(&segments[ENV_DECAY], 1.0f, sustain, decay, rate,
+                     exponential, ENV_DECAY_RATIO, ENV_SUSTAIN);
+    }
+    else
+    {
+        adsr_segment(&segments[ENV_DECAY], 1.0f, release, decay, rate,
+                     exponential, ENV_DECAY_RATIO, ENV_RELEASE);
+    }
+
+    /* The release ends under 0.001, the linear one always decays by a ratio of the output */
+    adsr_segment(&segments[ENV_RELEASE], 1.0f, 0.001f, release, rate,
+                 exponential, ENV_DECAY_RATIO, ENV_IDLE);
+    segments[ENV_RELEASE].end = 0.0f;
+    if (!exponential && release > 0.0f)
+    {
+        segments[ENV_RELEASE].mul = 1.0f - 1.0f / (release * rate);
+        segments[ENV_RELEASE].add = 0.0f;
+    }
+    else if (release <= 0.0f)
+    {
+        segments[ENV_RELEASE].add = 0.0f;
+    }
+
+    /* Linear fade out of a stolen voice */
+    adsr_segment(&segments[ENV_FADE], 1.0f, 0.0f, STEAL_FADE_TIME, rate,
+                 false, 0.0f, ENV_IDLE);
+}
+
+/*
+ * Process nframes samples from an envelope state with the given coefficients
+ * The amplification coefficients are written every stride floats of the buffer
+ * Returns the envelope amplification coeficient of the last sample
+ */
+float adsr_block(env_state_t *state, float *output,
+                 const adsr_coefs_t *coefs,
+                 float *buffer, int stride, int nframes)
+{
+    float out = *output;
+    int i = 0;
+
+    while (i < nframes)
+    {
+        switch (*state)
+        {
+        case ENV_IDLE:
+            for (; i < nframes; i++)
             {
-                adsr->output = 1.0;
-                adsr->state = ENV_DECAY;
+                buffer[i * stride] = 0.0f;
             }
-        }
-        else
-        {   /* If no attack, go in decay */
-            adsr->output = 1.0;
-            adsr->state = ENV_DECAY;
-        }
-        break;
-    case ENV_DECAY:
-        if (*adsr->decay > 0.0)
-        {
-            if (*adsr->sustain > 0.0)
-            {   /* Decrement the amplification by the decay amount relatively to the sustain amount */
-                float decrement = (1.0 - *adsr->sustain) / (*adsr->decay * RATE);
-                adsr->output -= decrement;
-
-                if (adsr->output <= *adsr->sustain)
+            break;
+        case ENV_SUSTAIN:
+            if (coefs->sustain == 0.0f)
+            {   /* The sustain was turned off, go in release */
+                const adsr_segment_t *release = &coefs->segments[ENV_RELEASE];
+                out = out * release->mul + release->add;
+                *state = ENV_RELEASE;
+                buffer[i++ * stride] = out;
+            }
+            else
+            {   /* We put the amplification at the sustain level */
+                out = coefs->sustain;
+                for (; i < nframes; i++)
                 {
-                    adsr->output = *adsr->sustain;
-                    adsr->state = ENV_SUSTAIN;
+                    buffer[i * stride] = out;
                 }
             }
-            else
-            {   /* Decrement the amplification by the decay amount relatively to the release amount */
-                float decrement = (1.0 - *adsr->release) / (*adsr->decay * RATE);
-                adsr->output -= decrement;
-
-                if (adsr->output <= *adsr->release && adsr->release)
+            break;
+        default:
+            {   /* Moving along the segment until it crosses its level */
+                const adsr_segment_t *segment = &coefs->segments[*state];
+                for (; i < nframes; i++)
                 {
-                    adsr->output = *adsr->release;
-                    adsr->state = ENV_RELEASE;
+                    out = out * segment->mul + segment->add;
+                    if ((out - segment->level) * segment->sign >= 0.0f)
+                    {
+                        out = segment->end;
+                        *state = segment->next;
+                        buffer[i++ * stride] = out;
+                        break;
+                    }
+                    buffer[i * stride] = out;
                 }
             }
+            break;
         }
-        else
-        {   /* If there is sustain, go in sustain */
-            if (*adsr->sustain > 0.0)
-            {
-                adsr->output = *adsr->sustain;
-                adsr->state = ENV_SUSTAIN;
-            }
-            /* Else go in release */
-            else
-            {
-                adsr->output = *adsr->release;
-                adsr->state = ENV_RELEASE;
-            }
+    }
+
+    *output = out;
+    /* Return the amplification of the ADSR envelope */
+    return out;
+}
+
+/*
+ * Allocate the voices pool arrays in a single aligned allocation
+ * Returns 1 if the allocation failed
+ */
+int voices_init(voices_t *voices, int count)
+{
+    /* The spare voices hold the fade out of the stolen voices */
+    int slots = count + STEAL_FADE_VOICES;
+
+    /* Padding the arrays to whole cache lines so that each one stays aligned */
+    int stride = (slots + CACHE_LINE_FLOATS - 1) & ~(CACHE_LINE_FLOATS - 1);
+    size_t osc_size = sizeof(float) * stride * 3;
+    size_t voice_size = sizeof(float) * stride;
+    size_t filter_size = sizeof(float) * stride * FILTER_STAGES;
+    size_t size = osc_size * 3 + filter_size + voice_size * 20;
+
+    char *memory = aligned_alloc(CACHE_LINE, size);
+    if (memory == NULL)
+    {
+        return 1;
+    }
+    memset(memory, 0, size);
+
+    voices->count = count;
+    voices->stride = stride;
+    voices->memory = memory;
+    voices->steal_policy = STEAL_RELEASED;
+    voices->filter_type = ONE_POLE_FILTER;
+
+    voices->phase = (float *)memory;
+    memory += osc_size;
+    voices->phase_inc = (float *)memory;
+    memory += osc_size;
+    voices->freq = (float *)memory;
+    memory += osc_size;
+    voices->env_output = (float *)memory;
+    memory += voice_size;
+    voices->env_state = (env_state_t *)memory;
+    memory += voice_size;
+    voices->velocity_amp = (float *)memory;
+    memory += voice_size;
+    voices->pitch = (float *)memory;
+    memory += voice_size;
+    voices->pitch_target = (float *)memory;
+    memory += voice_size;
+    voices->glide_rate = (float *)memory;
+    memory += voice_size;
+    voices->filter_state = (float *)memory;
+    memory += filter_size;
+    voices->filter_alpha = (float *)memory;
+    memory += voice_size;
+    voices->filter_env_output = (float *)memory;
+    memory += voice_size;
+    voices->filter_env_state = (env_state_t *)memory;
+    memory += voice_size;
+    voices->note = (int *)memory;
+    memory += voice_size;
+    voices->pressed = (int *)memory;
+    memory += voice_size;
+    voices->active = (int *)memory;
+    memory += voice_size;
+    voices->active_index = (int *)memory;
+    memory += voice_size;
+    voices->held = (int *)memory;
+
+    voice_list_t *lists[3] = {&voices->free, &voices->busy, &voices->released};
+    for (int l = 0; l < 3; l++)
+    {
+        memory += voice_size;
+        lists[l]->prev = (int *)memory;
+        memory += voice_size;
+        lists[l]->next = (int *)memory;
+    }
+
+    voices_reset(voices);
+
+    return 0;
+}
+
+/* Free the voices pool arrays */
+void voices_free(voices_t *voices)
+{
+    free(voices->memory);
+    voices->memory = NULL;
+}
+
+/* Returns true if the voice is in the list */
+static bool list_contains(const voice_list_t *list, int voice)
+{
+    return list->head == voice || list->prev[voice] != -1;
+}
+
+/* Append a voice at the tail of the list */
+static void list_push(voice_list_t *list, int voice)
+{
+    list->prev[voice] = list->tail;
+    list->next[voice] = -1;
+    if (list->tail != -1)
+    {
+        list->next[list->tail] = voice;
+    }
+    else
+    {
+        list->head = voice;
+    }
+    list->tail = voice;
+}
+
+/* Remove a voice from the list, does nothing if it isn't in it */
+static void list_remove(voice_list_t *list, int voice)
+{
+    if (!list_contains(list, voice))
+    {
+        return;
+    }
+
+    int prev = list->prev[voice], next = list->next[voice];
+    if (prev != -1)
+    {
+        list->next[prev] = next;
+    }
+    else
+    {
+        list->head = next;
+    }
+    if (next != -1)
+    {
+        list->prev[next] = prev;
+    }
+    else
+    {
+        list->tail = prev;
+    }
+    list->prev[voice] = -1;
+    list->next[voice] = -1;
+}
+
+/* Remove and return the voice at the head of the list, -1 if empty */
+static int list_pop(voice_list_t *list)
+{
+    int voice = list->head;
+    if (voice != -1)
+    {
+        list_remove(list, voice);
+    }
+    return voice;
+}
+
+/* Release all of the voices at once, cutting their sound */
+void voices_reset(voices_t *voices)
+{
+    voice_list_t *lists[3] = {&voices->free, &voices->busy, &voices->released};
+    for (int l = 0; l < 3; l++)
+    {
+        lists[l]->head = -1;
+        lists[l]->tail = -1;
+    }
+
+    for (int v = 0; v < voices->count + STEAL_FADE_VOICES; v++)
+    {
+        voices->env_state[v] = ENV_IDLE;
+        voices->pressed[v] = 0;
+        voices->note[v] = -1;
+        voices->active_index[v] = -1;
+        for (int l = 0; l < 3; l++)
+        {
+            lists[l]->prev[v] = -1;
+            lists[l]->next[v] = -1;
         }
-        break;
-    case ENV_SUSTAIN:
-        if (*adsr->sustain == 0.0)
-        {   /* Increment the amplification by the attack amount */
-            float decrement = adsr->output / (*adsr->release * RATE);
-            adsr->output -= decrement;
-            adsr->state = ENV_RELEASE;
+    }
+
+    /* The spare voices are never given to a note */
+    for (int v = 0; v < voices->count; v++)
+    {
+        list_push(&voices->free, v);
+    }
+
+    voices->active_count = 0;
+    voices->pressed_count = 0;
+    voices->quietest = -1;
+
+    for (int n = 0; n < MIDI_NOTES; n++)
+    {
+        voices->note_voice[n] = -1;
+    }
+}
+
+/* Returns the position of a note in the held voices, or where to insert it */
+static int held_search(const voices_t *voices, int note)
+{
+    int low = 0, high = voices->pressed_count;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (voices->note[voices->held[middle]] < note)
+        {
+            low = middle + 1;
         }
         else
         {
-            /* We put the amplification at the sustain level */
-            adsr->output = *adsr->sustain;
+            high = middle;
         }
-        break;
-    case ENV_RELEASE:
-        if (*adsr->release > 0.0)
-        {   /* Decrement the amplification by the release amount */
-            float decrement = adsr->output / (*adsr->release * RATE);
-            adsr->output -= decrement;
-            if (adsr->output <= 0.001)
+    }
+    return low;
+}
+
+/* Mark a voice as pressed with a note, inserting it in the held voices */
+static void held_insert(voices_t *voices, int voice, int note)
+{
+    int position = held_search(voices, note);
+    memmove(&voices->held[position + 1], &voices->held[position],
+            sizeof(int) * (voices->pressed_count - position));
+    voices->held[position] = voice;
+
+    voices->note[voice] = note;
+    voices->pressed[voice] = 1;
+    voices->note_voice[note] = voice;
+    voices->pressed_count++;
+}
+
+/* Mark a voice as not pressed anymore, removing it from the held voices */
+static void held_remove(voices_t *voices, int voice)
+{
+    int note = voices->note[voice];
+    int position = held_search(voices, note);
+    voices->pressed_count--;
+    memmove(&voices->held[position], &voices->held[position + 1],
+            sizeof(int) * (voices->pressed_count - position));
+
+    voices->note[voice] = -1;
+    voices->pressed[voice] = 0;
+    voices->note_voice[note] = -1;
+}
+
+/* Add a voice to the active list if it isn't in it */
+static void active_add(voices_t *voices, int voice)
+{
+    if (voices->active_index[voice] == -1)
+    {
+        voices->active_index[voice] = voices->active_count;
+        voices->active[voices->active_count++] = voice;
+    }
+}
+
+/*
+ * Start the envelopes of a voice and add it to the active list
+ * The filter of the voice starts closed and empty
+ */
+void voice_start(voices_t *voices, int voice)
+{
+    voices->env_state[voice] = ENV_ATTACK;
+    voices->filter_env_state[voice] = ENV_ATTACK;
+    voices->filter_env_output[voice] = 0.0f;
+    for (int s = 0; s < FILTER_STAGES; s++)
+    {
+        voices->filter_state[s * voices->stride + voice] = 0.0f;
+    }
+    voices->filter_alpha[voice] = 0.0f;
+    active_add(voices, voice);
+}
+
+/*
+ * Remove the idle voices from the active list, keeping the order of the others
+ * The idle voices that aren't pressed anymore go back to the free list
+ * Also finds the quietest sounding voice, for the voice stealing
+ */
+void voices_compact(voices_t *voices)
+{
+    int count = 0;
+    float quietest = 2.0f;
+    voices->quietest = -1;
+
+    for (int k = 0; k < voices->active_count; k++)
+    {
+        int v = voices->active[k];
+        if (voices->env_state[v] == ENV_IDLE)
+        {
+            voices->active_index[v] = -1;
+            if (!voices->pressed[v] && v < voices->count)
             {
-                adsr->output = 0.0;
-                adsr->state = ENV_IDLE;
+                list_remove(&voices->released, v);
+                list_remove(&voices->busy, v);
+                list_push(&voices->free, v);
             }
+            continue;
         }
-        else
-        {   /* If no release, go in idle state */
-            adsr->output = 0.0;
-            adsr->state = ENV_IDLE;
+        voices->active[count] = v;
+        voices->active_index[v] = count;
+        count++;
+
+        if (v < voices->count && voices->env_output[v] < quietest)
+        {
+            quietest = voices->env_output[v];
+            voices->quietest = v;
         }
-        break;
     }
-    /* Return the amplification of the ADSR envelope */
-    return adsr->output;
+    voices->active_count = count;
+}
+
+/*
+ * Copy a stolen voice into an idle spare voice, fading out from where it was
+ * The voice is cut short if every spare voice is already fading
+ */
+static void voice_fade(voices_t *voices, int voice)
+{
+    if (voices->env_state[voice] == ENV_IDLE)
+    {
+        return;
+    }
+
+    for (int spare = voices->count; spare < voices->count + STEAL_FADE_VOICES; spare++)
+    {
+        if (voices->env_state[spare] != ENV_IDLE || voices->active_index[spare] != -1)
+        {
+            continue;
+        }
+
+        for (int o = 0; o < 3; o++)
+        {
+            int from = o * voices->stride + voice, to = o * voices->stride + spare;
+            voices->phase[to] = voices->phase[from];
+            voices->phase_inc[to] = voices->phase_inc[from];
+            voices->freq[to] = voices->freq[from];
+        }
+        voices->env_output[spare] = voices->env_output[voice];
+        voices->velocity_amp[spare] = voices->velocity_amp[voice];
+        voices->pitch[spare] = voices->pitch[voice];
+        voices->pitch_target[spare] = voices->pitch_target[voice];
+        voices->glide_rate[spare] = voices->glide_rate[voice];
+        for (int s = 0; s < FILTER_STAGES; s++)
+        {
+            int from = s * voices->stride + voice, to = s * voices->stride + spare;
+            voices->filter_state[to] = voices->filter_state[from];
+        }
+        voices->filter_alpha[spare] = voices->filter_alpha[voice];
+        voices->filter_env_output[spare] = voices->filter_env_output[voice];
+        voices->filter_env_state[spare] = voices->filter_env_state[voice];
+        voices->env_state[spare] = ENV_FADE;
+        active_add(voices, spare);
+        return;
+    }
+}
+
+/*
+ * Take a voice from the notes already playing when no voice is free
+ * The voice is chosen by the steal policy, then faded out
+ */
+static int voice_steal(voices_t *voices)
+{
+    int voice = voices->busy.head;
+
+    if (voices->steal_policy == STEAL_QUIETEST &&
+        voices->quietest != -1 &&
+        list_contains(&voices->busy, voices->quietest))
+    {
+        voice = voices->quietest;
+    }
+    else if (voices->steal_policy == STEAL_RELEASED &&
+             voices->released.head != -1)
+    {
+        voice = voices->released.head;
+    }
+
+    if (voice == -1)
+    {
+        return -1;
+    }
+
+    voice_fade(voices, voice);
+    voices->env_state[voice] = ENV_IDLE;
+    list_remove(&voices->busy, voice);
+    list_remove(&voices->released, voice);
+
+    if (voices->pressed[voice])
+    {
+        held_remove(voices, voice);
+    }
+    if (voices->quietest == voice)
+    {
+        voices->quietest = -1;
+    }
+
+    return voice;
 }
 
+/*
+ * Press a note on the voice already holding it, else on the next free voice
+ * If no voice is free, one is stolen with the steal policy
+ * Returns the index of the voice, -1 if none could be found
+ */
+int voice_press(voices_t *voices, int note)
+{
+    int voice = voices->note_voice[note];
+    if (voice == -1)
+    {
+        voice = list_pop(&voices->free);
+    }
+    if (voice == -1)
+    {
+        voice = voice_steal(voices);
+    }
+    if (voice == -1)
+    {
+        return -1;
+    }
+
+    /* The pressed voice becomes the newest busy voice */
+    list_remove(&voices->busy, voice);
+    list_push(&voices->busy, voice);
+
+    if (!voices->pressed[voice])
+    {
+        held_insert(voices, voice, note);
+    }
+
+    return voice;
+}
 
-/* Process the synth voices into the sound buffer */
-double process_voices(synth_t *synth)
+/*
+ * Release the voice holding a note
+ * The voice goes back to the free list once it is idle
+ * Returns the index of the voice, -1 if the note isn't pressed
+ */
+int voice_release(voices_t *voices, int note)
 {
+    int voice = voices->note_voice[note];
+    if (voice == -1)
+    {
+        return -1;
+    }
 
+    held_remove(voices, voice);
 
-    double mixed_voices = 0.0;
+    if (voices->active_index[voice] != -1)
+    {   /* Still sounding, freed by voices_compact when its release ends */
+        list_push(&voices->released, voice);
+    }
+    else
+    {
+        list_remove(&voices->busy, voice);
+        list_push(&voices->free, voice);
+    }
 
-    for (int v = 0; v < VOICES; v++)
+    return voice;
+}
+
+/* Returns the detune applied to the oscillators, from the LFO if it modulates it */
+static float current_detune(synth_t *synth)
+{
+    if (synth->params->lfo_param == LFO_DETUNE)
     {
-        voice_t *voice = &synth->voices[v];
-        if (voice->adsr->state == ENV_IDLE)
+        return synth->lfo_detune;
+    }
+    return synth->detune;
+}
+
+/* Returns the frequency ratio of the oscillator B for a detune, the oscillator C gets its inverse */
+static float detune_ratio(float detune)
+{
+    return cents_ratio(detune * DETUNE_CENTS);
+}
+
+/*
+ * Set the oscillators frequencies of a voice from its pitch,
+ * the pitch bend and the detune ratio
+ */
+static void tune_voice(synth_t *synth, int voice, float ratio)
+{
+    voices_t *voices = synth->voices;
+    int stride = voices->stride;
+    float pitch = voices->pitch[voice];
+
+    /* The notes are read from the table, only the gliding pitches are computed */
+    float freq = (pitch == voices->pitch_target[voice])
+                     ? note_freq((int)pitch)
+                     : A_4 * fast_exp2((pitch - A4_POSITION) / 12.0f);
+    freq *= synth->bend;
+
+    voices->freq[voice] = freq;
+    voices->freq[stride + voice] = freq * ratio;
+    voices->freq[2 * stride + voice] = freq / ratio;
+    for (int o = 0; o < 3; o++)
+    {
+        voices->phase_inc[o * stride + voice] = voices->freq[o * stride + voice] / synth->rate;
+    }
+}
+
+/* Move the gliding voices toward their target pitch by nframes samples */
+static void process_glide(synth_t *synth, int nframes)
+{
+    voices_t *voices = synth->voices;
+    float ratio = detune_ratio(current_detune(synth));
+    int gliding = 0;
+
+    for (int k = 0; k < voices->active_count; k++)
+    {
+        int v = voices->active[k];
+        float pitch = voices->pitch[v], target = voices->pitch_target[v];
+        if (pitch == target)
         {
             continue;
         }
 
-        if ((synth->arp && v == synth->active_arp) || !synth->arp)
+        float move = voices->glide_rate[v] * nframes;
+        if (fabsf(target - pitch) <= move)
         {
-            float envelope = adsr_process(voice->adsr);
-            double mixed_osc = 0.0;
+            pitch = target;
+        }
+        else
+        {
+            pitch += (target > pitch) ? move : -move;
+            gliding++;
+        }
+        voices->pitch[v] = pitch;
+        tune_voice(synth, v, ratio);
+    }
 
-            for (int o = 0; o < 3; o++)
-            {
-                osc_t *osc = &voice->oscillators[o];
-                double phase_inc = osc->freq / RATE;
-                double sample;
+    synth->gliding = gliding;
+}
 
-                switch (*osc->wave)
-                {
-                case SINE_WAVE:
-                    sample = sin(2.0 * M_PI * osc->phase);
-                    break;
-                case SQUARE_WAVE:
-                    sample = (osc->phase < 0.5) ? 1.0 : -1.0;
-                    break;
-                case TRIANGLE_WAVE:
-                    sample = 1.0 - 4.0 * fabs(osc->phase - 0.5);
-                    break;
-                case SAWTOOTH_WAVE:
-                    sample = 2.0 * osc->phase - 1.0;
-                    break;
-                default:
-                    sample = 0.0;
-                    break;
-                }
+/*
+ * Press a note on a voice and start it with the given MIDI velocity
+ * Restarts the filter envelope and the arpeggio on the first pressed note
+ * Notes outside the MIDI range (0 to 127) are ignored
+ */
+void synth_note_on(synth_t *synth, int note, int velocity)
+{
+    /* The voices maps are indexed by the note */
+    if (note < 0 || note >= MIDI_NOTES)
+    {
+        return;
+    }
 
-                mixed_osc += sample;
+    int pressed_voices = synth->voices->pressed_count;
 
-                osc->phase += phase_inc;
-                if (osc->phase >= 1.0)
-                {
-                    osc->phase -= 1.0;
-                }
-            }
+    /*
+     * A note already sounding keeps its voice, otherwise an idle voice is taken from the free list,
+     * and only when all of them are busy voice_steal fades one out following the steal policy
+     */
+    int voice = voice_press(synth->voices, note);
+    if (voice == -1)
+    {
+        return;
+    }
 
-            /* Oscillator sound mix */
-            mixed_osc /= 3.0;
-            mixed_osc *= envelope;
-            mixed_osc *= voice->velocity_amp;
+    change_freq(synth, voice, note, velocity);
+    if (pressed_voices == 0 && synth->params->filter_env)
+    {
+        synth->filter->adsr.state = ENV_ATTACK;
+    }
 
-            if (synth->lfo->mod_param == LFO_AMP)
-            {
-                mixed_osc *= synth->lfo_amp;
-            }
-            else
-            {
-                mixed_osc *= synth->amp;
-            }
+    if (synth->params->arp && pressed_voices == 0)
+    {
+        synth->active_arp_float = 1.0;
+    }
+}
+
+/*
+ * Release the voice holding a note, does nothing if the note isn't pressed
+ * or is outside the MIDI range
+ * The voice is cut when the arpeggiator is on, else it goes in release
+ */
+void synth_note_off(synth_t *synth, int note)
+{
+    if (note < 0 || note >= MIDI_NOTES)
+    {
+        return;
+    }
+
+    voices_t *voices = synth->voices;
+    int pressed_voices = voices->pressed_count;
+    bool arp = synth->params->arp;
 
-            mixed_voices += mixed_osc;
+    int v = voice_release(voices, note);
+    if (v != -1)
+    {
+        if (arp && voices->env_state[v] != ENV_IDLE)
+        {
+            voices->env_state[v] = ENV_IDLE;
+        }
+        else if (!arp &&
+                 voices->env_state[v] != ENV_RELEASE &&
+                 voices->env_state[v] != ENV_IDLE)
+        {
+            voices->env_state[v] = ENV_RELEASE;
         }
     }
-    
-    return mixed_voices;
+
+    if (arp && pressed_voices == 2)
+    {
+        synth->active_arp_float = 1.0;
+    }
 }
 
-/* Process the LFO modulation */
-void process_lfo(synth_t *synth)
+/*
+ * Process the synth voices into the sound buffer
+ * The buffer is overwritten with the mix of the active voices
+ * The lfo buffer holds the LFO automation computed by process_lfo
+ */
+void process_voices(synth_t *synth, float *buffer,
+                    const float *lfo, int nframes)
 {
-    if (synth->lfo->mod_param != LFO_OFF)
+    const synth_params_t *params = synth->params;
+    float amp[FRAMES];
+
+    memset(buffer, 0, sizeof(float) * nframes);
+
+    /* Amplification curve of the block, shared by all voices */
+    if (params->lfo_param == LFO_AMP)
     {
-        /* Processing the LFO */
-        double phase_inc = synth->lfo->osc->freq / RATE;
-        double automation;
-        
-        /* Calculating the wave from the LFO */
-        switch (*synth->lfo->osc->wave)
+        for (int i = 0; i < nframes; i++)
         {
-        case SINE_WAVE:
-            automation = fabs(sin(2.0 * M_PI * synth->lfo->osc->phase));
-            break;
-        case SQUARE_WAVE:
-            automation = (synth->lfo->osc->phase < 0.5) ? 1.0 : 0.0;
-            break;
-        case TRIANGLE_WAVE:
-            automation = fabs(1.0 - 4.0 * fabs(synth->lfo->osc->phase - 0.5));
-            break;
-        case SAWTOOTH_WAVE:
-            automation = synth->lfo->osc->phase;
-            break;
-        default:
-            automation = 0.0;
-            break;
+            amp[i] = params->amp * lfo[i];
         }
-
-        /* Applyging the LFO to the assigned parameter */
-        switch (synth->lfo->mod_param)
+    }
+    else
+    {
+        for (int i = 0; i < nframes; i++)
         {
-        case LFO_CUTOFF:
-            synth->filter->lfo_cutoff = synth->filter->cutoff * automation;
-            break;
-        case LFO_DETUNE:
-            synth->lfo_detune = synth->detune * automation;
-            apply_detune_change(synth);
-            break;
-        case LFO_AMP:
-            synth->lfo_amp = synth->amp * automation;
-            break;
-        default:
-            break;
+            amp[i] = params->amp;
         }
+    }
+
+    int only_voice = -1;
+    if (params->arp)
+    {
+        only_voice = arpeggiator_voice(synth);
+        if (only_voice == -1)
+        {   /* No held note, only the stolen voices fade out */
+            only_voice = synth->voices->count;
+        }
+    }
 
-        synth->lfo->osc->phase += phase_inc;
-        if (synth->lfo->osc->phase >= 1.0)
+    dsp_render_voices(
+        synth->voices, params, &synth->envelope, &synth->filter_envelope,
+        synth->wavetables, synth->pool, buffer, amp,
+        (params->lfo_param == LFO_DETUNE || params->lfo_param == LFO_CUTOFF) ? lfo : NULL,
+        detune_ratio(synth->detune), synth->rate, synth->control_rate, only_voice, nframes);
+}
+
+/* Returns the LFO output of a waveform at a phase */
+static float lfo_wave_value(const synth_t *synth, int wave, float phase)
+{
+    switch (wave)
+    {
+    case SINE_WAVE:
+        return (synth->wavetables != NULL)
+                   ? fabsf(wavetable_lookup(synth->wavetables, SINE_WAVE, phase))
+                   : fabsf(sinf(2.0f * (float)M_PI * phase));
+    case SQUARE_WAVE:
+        return (phase < 0.5f) ? 1.0f : 0.0f;
+    case TRIANGLE_WAVE:
+        return fabsf(1.0f - 4.0f * fabsf(phase - 0.5f));
+    case SAWTOOTH_WAVE:
+        return phase;
+    default:
+        return 0.0f;
+    }
+}
+
+/*
+ * Process the LFO modulation
+ * The LFO is evaluated once per control tick, in between
+ * the lfo buffer holds a linear ramp from one tick to the next
+ */
+void process_lfo(synth_t *synth, float *lfo, int nframes)
+{
+    const synth_params_t *params = synth->params;
+    if (params->lfo_param == LFO_OFF)
+    {
+        return;
+    }
+
+    int rate = synth->control_rate;
+    float phase_inc = params->lfo_freq / synth->rate;
+    float phase = synth->lfo->phase;
+    float value = synth->lfo->value;
+
+    for (int start = 0; start < nframes; start += rate)
+    {
+        int length = (nframes - start < rate) ? nframes - start : rate;
+
+        /* Evaluating the LFO at the end of the tick, then ramping to it */
+        phase += phase_inc * length;
+        phase -= floorf(phase);
+        float target = lfo_wave_value(synth, params->lfo_wave, phase);
+        float step = (target - value) / length;
+
+        for (int i = start; i < start + length - 1; i++)
         {
-            synth->lfo->osc->phase -= 1.0;
+            value += step;
+            lfo[i] = value;
         }
+        value = target;
+        lfo[start + length - 1] = value;
+    }
+    synth->lfo->phase = phase;
+    synth->lfo->value = value;
+
+    /* Keeping the modulated parameter at the end of the block for the GUI */
+    switch (params->lfo_param)
+    {
+    case LFO_CUTOFF:
+        synth->filter->lfo_cutoff = params->cutoff * lfo[nframes - 1];
+        break;
+    case LFO_DETUNE:
+        synth->lfo_detune = params->detune * lfo[nframes - 1];
+        apply_detune_change(synth);
+        break;
+    case LFO_AMP:
+        synth->lfo_amp = params->amp * lfo[nframes - 1];
+        break;
+    default:
+        break;
     }
 }
 
-/* Process the gain and low-pass filter onto the sound buffer */
-double process_gain(synth_t synth, double sample, int active_voices)
+/* Process the gain onto the sound buffer */
+void process_gain(synth_t *synth, float *buffer,
+                  int nframes, int active_voices)
 {
     /* No gain if arpeggio*/
-    if (synth.arp)
+    if (synth->params->arp)
     {
-        return sample;
+        return;
     }
     
      /* Gain to stay at the same level despite the number of active voices */
-    double gain = (active_voices > 0)
-                      ? 1.0 / sqrt((double)active_voices)
-                      : 0.0;
+    float gain = (active_voices > 0)
+                     ? 1.0 / sqrt((double)active_voices)
+                     : 0.0;
 
     /* Gain processing */
-    double processed_sample = sample * gain;
-    if (processed_sample > 1.0)
+    for (int i = 0; i < nframes; i++)
     {
-        processed_sample = 1.0;
+        float processed_sample = buffer[i] * gain;
+        if (processed_sample > 1.0f)
+        {
+            processed_sample = 1.0f;
+        }
+        if (processed_sample < -1.0f)
+        {
+            processed_sample = -1.0f;
+        }
+        buffer[i] = processed_sample;
     }
-    if (processed_sample < -1.0)
+}
+
+/*
+ * Process the low-pass filter onto the sound buffer
+ * The cutoff modulations are evaluated once per control tick
+ * and the filter coefficient ramps linearly in between
+ */
+void process_filter(synth_t *synth, float *buffer,
+                    const float *lfo, int nframes)
+{
+    const synth_params_t *params = synth->params;
+    lp_filter_t *filter = synth->filter;
+    bool lfo_cutoff = params->lfo_param == LFO_CUTOFF;
+    int rate = synth->control_rate;
+
+    for (int start = 0; start < nframes; start += rate)
     {
-        processed_sample = -1.0;
-    }
+        int length = (nframes - start < rate) ? nframes - start : rate;
+        int end = start + length;
+        float cutoff = params->cutoff;
 
-    return processed_sample;
+        if (params->filter_env)
+        {   /* The envelope runs at audio rate, its level is read at the end of the tick */
+            float env_buffer[MAX_CONTROL_RATE];
+            float env = adsr_block(&filter->adsr.state, &filter->adsr.output,
+                                   &synth->filter_envelope, env_buffer, 1, length);
+            cutoff = params->cutoff + env / 2;
+            if (cutoff > 1.0f)
+            {
+                cutoff = 1.0f;
+            }
+            filter->env_cutoff = cutoff;
+        }
+
+        /* If the LFO is on the filter, override the filter envelope */
+        if (lfo_cutoff)
+        {
+            cutoff = params->cutoff * lfo[end - 1];
+        }
+
+        filter_process_block(filter, buffer + start, params->filter_type,
+                             cutoff, params->resonance, length);
+    }
 }
 
-double process_filter(synth_t *synth, double sample)
+/*
+ * Advance the arpeggiator clock by up to nframes samples
+ * Returns the number of samples until the next arpeggio step included,
+ * or nframes if the step doesn't happen in this block
+ */
+int process_arpeggiator(synth_t *synth, int nframes)
 {
-    double cutoff = synth->filter->cutoff;
- 
-    if (synth->filter->env)
+    if (!synth->params->arp)
     {
-        cutoff = synth->filter->cutoff +
-                        adsr_process(synth->filter->adsr) / 2;
-        if (cutoff > 1.0)
+        return nframes;
+    }
+
+    float bpm_increment = 1.0 / (60.0 / (float)synth->params->bpm * synth->rate);
+    for (int i = 0; i < nframes; i++)
+    {
+        synth->active_arp_float += bpm_increment;
+        if (synth->active_arp_float >= 1.0)
         {
-            cutoff = 1.0;
+            return i + 1;
         }
-        synth->filter->env_cutoff = cutoff;
     }
+    return nframes;
+}
 
-    /* If the LFO is on the filter, override the filter envelope */
-    if (synth->lfo->mod_param == LFO_CUTOFF)
+/* Returns the voice of the held note played by the arpeggiator, -1 if none */
+int arpeggiator_voice(synth_t *synth)
+{
+    if (synth->active_arp >= synth->voices->pressed_count)
     {
-        cutoff = synth->filter->lfo_cutoff;
+        return -1;
     }
-    return lp_process(synth->filter, sample, cutoff);
+    return synth->voices->held[synth->active_arp];
 }
 
-/* Process the arpeggiator */
-void process_arpeggiator(synth_t *synth, int active_voices)
+/* Move the arpeggiator to its next held note */
+void arpeggiator_step(synth_t *synth)
 {
-    if (synth->arp)
+    synth->active_arp++;
+    if (synth->active_arp >= synth->voices->pressed_count)
     {
-        float bpm_increment = 1.0 / (60.0 / (float)synth->bpm * RATE);
-        synth->active_arp_float += bpm_increment;
+        synth->active_arp = 0;
+    }
 
-        if (synth->active_arp_float >= 1.0)
+    synth->active_arp_float = 0.0;
+
+    /* Reseting ADSR envelope */
+    int voice = arpeggiator_voice(synth);
+    if (voice != -1)
+    {
+        /* The held voice was idle, its detune and pitch bend may be out of date */
+        tune_voice(synth, voice, detune_ratio(current_detune(synth)));
+        voice_start(synth->voices, voice);
+        if (synth->params->filter_env)
         {
-            synth->active_arp++;
-            if (synth->active_arp >= active_voices)
-            {
-                synth->active_arp = 0;
-            }
-                
+            synth->filter->adsr.state = ENV_ATTACK;
+        }
+    }
+}
 
-            synth->active_arp_float = 0.0;
-            
-            /* Reseting ADSR envelope */
-            if (synth->voices[synth->active_arp].pressed)
-            {
-                synth->voices[synth->active_arp].adsr->state = ENV_ATTACK;
-                if (synth->filter->env)
-                {
-                    synth->filter->adsr->state = ENV_ATTACK;
-                }
-            }
+/*
+ * Render a block of samples from the synth into the output buffer
+ * The parameters are read from synth->params, which must be set
+ * The block is cut at the arpeggio steps so that every stage
+ * processes a run of samples with the same active voices
+ */
+void synth_render(synth_t *synth, float *out, int nframes)
+{
+    float lfo[FRAMES];
+
+    /* The envelopes coefficients of the block */
+    const synth_params_t *params = synth->params;
+    adsr_coefs_init(&synth->envelope,
+                    params->attack, params->decay,
+                    params->sustain, params->release, params->exp_env, synth->rate);
+    adsr_coefs_init(&synth->filter_envelope,
+                    params->filter_attack, params->filter_decay,
+                    params->filter_sustain, params->filter_release, params->exp_env, synth->rate);
+
+    /* The detune and pitch bend parameters are applied to the voices at the start of the block */
+    if (synth->detune != synth->params->detune ||
+        synth->pitch_bend != synth->params->pitch_bend)
+    {
+        synth->detune = synth->params->detune;
+        synth->pitch_bend = synth->params->pitch_bend;
+        synth->bend = cents_ratio(synth->pitch_bend * PITCH_BEND_RANGE * 100.0f);
+        apply_detune_change(synth);
+    }
+
+    /* Only the voices that aren't idle are left in the active list */
+    voices_compact(synth->voices);
+    int active_voices = synth->voices->active_count;
+
+    int done = 0;
+    while (done < nframes)
+    {
+        int length = nframes - done;
+        if (length > FRAMES)
+        {
+            length = FRAMES;
+        }
+
+        /* The gliding voices are retuned at each control tick */
+        if (synth->gliding > 0 && length > synth->control_rate)
+        {
+            length = synth->control_rate;
+        }
+
+        /* Cutting the run at the next arpeggio step */
+        int step_length = process_arpeggiator(synth, length);
+        bool step = synth->params->arp && synth->active_arp_float >= 1.0;
+
+        float *buffer = out + done;
+        process_lfo(synth, lfo, step_length);
+        process_voices(synth, buffer, lfo, step_length);
+        process_glide(synth, step_length);
+        process_gain(synth, buffer, step_length, active_voices);
+        /* The voice filters replace the filter of the mix */
+        if (!synth->params->voice_filters)
+        {
+            process_filter(synth, buffer, lfo, step_length);
+        }
 
-            /* debug logs */
-            //fprintf(stderr, "\nfirst note %d\n", synth->voices[0].note);
-            //fprintf(stderr, "active voices %d\n", active_voices);
-            //fprintf(stderr, "active arp %d\n", synth->active_arp);
+        if (step)
+        {
+            arpeggiator_step(synth);
         }
+
+        done += step_length;
     }
 }
 
 /*
- * Change the frequency of a voice_t oscillators with the given MIDI note and velocity
- * Multiplied by the synth_t detune coefficient
+ * Change the frequency of a voice oscillators with the given MIDI note and velocity
+ * The note glides from the last played note when the glide is on
+ * The oscillators B and C are detuned by the synth_t detune in cents
  */
-void change_freq(voice_t *voice, int note,
-                 int velocity, double detune)
+void change_freq(synth_t *synth, int voice, int note, int velocity)
 {
-    int a4_diff = note - A4_POSITION;
+    voices_t *voices = synth->voices;
+    float glide = synth->params->glide;
+    int stride = voices->stride;
 
     /* Activating the voice */
-    voice->note = note;
-    voice->adsr->output = 0.001;
-    voice->adsr->state = ENV_ATTACK;
-    voice->velocity_amp = velocity / MIDI_MAX_VALUE;
+    voices->note[voice] = note;
+    voices->env_output[voice] = 0.001;
+    voice_start(voices, voice);
+    voices->velocity_amp[voice] = velocity / MIDI_MAX_VALUE;
+
+    voices->pitch_target[voice] = note;
+    if (glide > 0.0f && synth->last_pitch >= 0.0f && synth->last_pitch != note)
+    {   /* Sliding from the last played note in the glide time */
+        voices->pitch[voice] = synth->last_pitch;
+        voices->glide_rate[voice] = fabsf(note - synth->last_pitch) / (glide * synth->rate);
+        synth->gliding++;
+    }
+    else
+    {
+        voices->pitch[voice] = note;
+        voices->glide_rate[voice] = 0.0f;
+    }
+    synth->last_pitch = note;
 
     /* Applying the frequency and detune effect to the oscillators */
-    voice->oscillators[0].freq = A_4 * pow(2, a4_diff / 12.0);
-    voice->oscillators[0].phase = 0.0;
-    voice->oscillators[1].freq = A_4 * pow(2, a4_diff / 12.0) + (5 * detune);
-    voice->oscillators[1].phase = 0.0;
-    voice->oscillators[2].freq = A_4 * pow(2, a4_diff / 12.0) - (5 * detune);
-    voice->oscillators[2].phase = 0.0;
+    tune_voice(synth, voice, detune_ratio(current_detune(synth)));
+
+    for (int o = 0; o < 3; o++)
+    {
+        voices->phase[o * stride + voice] = 0.0;
+    }
 }
 
-/* Apply the detune change to the voices oscillators */
+/* Apply the detune and pitch bend changes to the voices oscillators */
 void apply_detune_change(synth_t *synth)
 {
-    float detune;
-    if (synth->lfo->mod_param == LFO_DETUNE)
-    {
-        detune = synth->lfo_detune;
-    }
-    else 
-    {
-        detune = synth->detune;
-    }
-    
-    for (int v = 0; v < VOICES; v++)
+    voices_t *voices = synth->voices;
+    float ratio = detune_ratio(current_detune(synth));
+
+    /* The idle voices get their detune when they are started */
+    for (int k = 0; k < voices->active_count; k++)
     {
-        int a4_diff = synth->voices[v].note - A4_POSITION;
-        synth->voices[v].oscillators[1].freq = A_4 * pow(2, a4_diff / 12.0) + (5 * detune);
-        synth->voices[v].oscillators[2].freq = A_4 * pow(2, a4_diff / 12.0) - (5 * detune);
+        tune_voice(synth, voices->active[k], ratio);
     }
 }
 
@@ -389,87 +1144,127 @@ const char *get_wave_name(int wave)
     }
 }
 
+/* Returns the low-pass filter coefficient of a cutoff between 0.0 and 1.0 at the sample rate */
+float lp_alpha(float cutoff, int rate)
+{
+    return filter_coefficient(ONE_POLE_FILTER, cutoff, rate);
+}
+
 /*
- * Process a sample with the low-pass filter and the given cutoff
- * Returns the processed sample
+ * Returns the coefficient of the filter type for a cutoff,
+ * only recomputed when the cutoff changed since the last call
  */
-double lp_process(lp_filter_t *filter, double input,
-                float cutoff)
+static float lp_coefficient(lp_filter_t *filter, float cutoff)
 {
-    /* Clipping */
-    if (cutoff > 1.0f)
+    if (cutoff != filter->cutoff)
     {
-        cutoff = 1.0f;
-    }
-    if (cutoff < 0.0f)
-    {
-        cutoff = 0.0f;
+        filter->cutoff = cutoff;
+        filter->target = filter_coefficient(filter->type, cutoff, filter->rate);
     }
+    return filter->target;
+}
 
+/*
+ * Process a sample with the low-pass filter and the given cutoff
+ * Returns the processed sample
+ */
+float lp_process(lp_filter_t *filter, float input,
+                 float cutoff)
+{
     /* Calculating the filter amplification */
-    float frequency = cutoff * (RATE / 8.0f);
-    float omega = 2.0f * M_PI * frequency / RATE;
-    float alpha = omega / (omega + 1.0f);
-    float input_f = (float)input;
-    float output = alpha * input_f + (1.0f - alpha) * filter->prev_output;
+    float alpha = lp_coefficient(filter, cutoff);
+    float output = alpha * input + (1.0f - alpha) * filter->prev_output;
+    filter->alpha = alpha;
 
     /* Setting the previous output and input of the filter */
     filter->prev_output = output;
-    filter->prev_input = input_f;
+    filter->prev_input = input;
 
-    return (double)output;
+    return output;
 }
 
 /*
- * Returns the first free voice from the synth_t
- * Used to assign a note send by MIDI or keyboard to the first free voice
+ * Process a buffer in place with the low-pass filter and the given cutoff
+ * The coefficient ramps linearly from the current one to the one of the cutoff,
+ * it stays constant when the cutoff didn't change
  */
-voice_t *get_free_voice(synth_t *synth)
+void lp_process_block(lp_filter_t *filter, float *buffer,
+                      float cutoff, int nframes)
 {
-    for (int i = 0; i < VOICES; i++)
+    if (nframes <= 0)
     {
-        if (!synth->arp && synth->voices[i].adsr->state == ENV_IDLE)
+        return;
+    }
+
+    float target = lp_coefficient(filter, cutoff);
+    float alpha = filter->alpha;
+    float output = filter->prev_output;
+
+    if (target == alpha)
+    {
+        float beta = 1.0f - alpha;
+        for (int i = 0; i < nframes; i++)
         {
-            return &synth->voices[i];
+            output = alpha * buffer[i] + beta * output;
+            buffer[i] = output;
         }
-        else if (synth->arp && !synth->voices[i].pressed)
+    }
+    else
+    {
+        float step = (target - alpha) / nframes;
+        for (int i = 0; i < nframes; i++)
         {
-            return &synth->voices[i];
+            alpha += step;
+            output = alpha * buffer[i] + (1.0f - alpha) * output;
+            buffer[i] = output;
         }
     }
-    return NULL;
+
+    filter->alpha = target;
+    filter->prev_output = output;
+    filter->prev_input = buffer[nframes - 1];
 }
 
-/* Insertion sort algorithm for the voices of a synth_t, used for arpeggiator */
-void sort_synth_voices(synth_t *synth)
+/*
+ * Process a buffer in place with the filter of the given type, cutoff and resonance
+ * The filter is emptied when its type changes, the coefficient then starts
+ * from the one of the new type
+ */
+void filter_process_block(lp_filter_t *filter, float *buffer, int type,
+                          float cutoff, float resonance, int nframes)
 {
-    /* First sort the voices */
-    for (int v = 1; v < VOICES; v++)
+    if (nframes <= 0)
     {
-        voice_t current = synth->voices[v];
-        int i = v - 1;
-        
-        while (i >= 0 && synth->voices[i].note > current.note)
-        {
-            synth->voices[i + 1] = synth->voices[i];
-            i--;
-        }
+        return;
+    }
 
-        synth->voices[i + 1] = current;
+    if (type != filter->type)
+    {
+        filter->type = type;
+        filter->prev_input = 0.0f;
+        filter->prev_output = 0.0f;
+        memset(filter->state, 0, sizeof(filter->state));
+        filter->cutoff = cutoff;
+        filter->target = filter_coefficient(type, cutoff, filter->rate);
+        filter->alpha = filter->target;
     }
 
-    /* Then move the voices with empty notes to the end */
-    for (int v = 1; v < VOICES; v++)
+    if (type == ONE_POLE_FILTER)
     {
-        voice_t current = synth->voices[v];
-        int i = v - 1;
-        
-        while (i >= 0 && synth->voices[i].note == -1)
-        {
-            synth->voices[i + 1] = synth->voices[i];
-            i--;
-        }
+        lp_process_block(filter, buffer, cutoff, nframes);
+        return;
+    }
 
-        synth->voices[i + 1] = current;
+    float target = lp_coefficient(filter, cutoff);
+    if (type == LADDER_FILTER)
+    {
+        ladder_process_block(filter->state, buffer, filter->alpha, target,
+                             ladder_feedback(resonance), nframes);
+    }
+    else
+    {
+        svf_process_block(filter->state, type, buffer, filter->alpha, target,
+                          svf_damping(resonance), nframes);
     }
+    filter->alpha = target;
 }
@@ -0,0 +1,140 @@
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdbool.h>
+
+#include "defs.h"
+#include "wavetable.h"
+
+/*
+ * Fill a band-limited table by additive synthesis of its harmonics
+ * The harmonics are read from the sine table, the index k * i stays exact
+ * Odd only keeps the odd harmonics, cosine uses a quarter period shift
+ */
+static void build_harmonics(float *table, const float *sine, int size,
+                            int harmonics, bool odd_only, bool cosine,
+                            double amplitude, int power)
+{
+    for (int i = 0; i < size; i++)
+    {
+        double sample = 0.0;
+        for (int k = 1; k <= harmonics; k += odd_only ? 2 : 1)
+        {
+            unsigned int index = (unsigned int)k * (unsigned int)i;
+            if (cosine)
+            {
+                index += size / 4;
+            }
+            sample += sine[index & (size - 1)] / ((power == 2) ? (double)k * k : (double)k);
+        }
+        table[i] = amplitude * sample;
+    }
+    /* Guard sample */
+    table[size] = table[0];
+}
+
+/*
+ * Build the wavetables of every waveform with the given size,
+ * band-limited for the sample rate
+ * Returns 1 if the size is not a power of two or if the allocation failed
+ */
+int wavetables_init(wavetables_t *wavetables, int size, int rate)
+{
+    if (size < WAVETABLE_MIN_SIZE || size > WAVETABLE_MAX_SIZE ||
+        (size & (size - 1)) != 0)
+    {
+        fprintf(stderr, "wavetable size must be a power of two between %d and %d.\n",
+                WAVETABLE_MIN_SIZE, WAVETABLE_MAX_SIZE);
+        return 1;
+    }
+
+    /* One level per octave, from the base frequency up to the Nyquist frequency */
+    int levels = 1;
+    while (WAVETABLE_BASE_FREQ * (1 << (levels - 1)) < rate / 2.0)
+    {
+        levels++;
+    }
+
+    /* The tables are padded to whole cache lines, after the guard sample */
+    int stride = (size + 1 + CACHE_LINE_FLOATS - 1) & ~(CACHE_LINE_FLOATS - 1);
+    int total_levels = 1 + 3 * levels;
+    float *memory = aligned_alloc(CACHE_LINE, sizeof(float) * stride * total_levels);
+    if (memory == NULL)
+    {
+        fprintf(stderr, "memory allocation failed.\n");
+        return 1;
+    }
+
+    wavetables->size = size;
+    wavetables->stride = stride;
+    wavetables->memory = memory;
+    wavetables->levels[SINE_WAVE] = 1;
+    wavetables->tables[SINE_WAVE] = memory;
+    for (int wave = SQUARE_WAVE; wave <= SAWTOOTH_WAVE; wave++)
+    {
+        wavetables->levels[wave] = levels;
+        wavetables->tables[wave] = memory + (1 + (wave - SQUARE_WAVE) * levels) * stride;
+    }
+
+    float *sine = wavetables->tables[SINE_WAVE];
+    for (int i = 0; i < size; i++)
+    {
+        sine[i] = sin(2.0 * M_PI * i / size);
+    }
+    sine[size] = sine[0];
+
+    for (int level = 0; level < levels; level++)
+    {
+        /* Harmonics under the Nyquist frequency at the top of the octave, within the table resolution */
+        int harmonics = (rate / 2.0) / (WAVETABLE_BASE_FREQ * (1 << level));
+        if (harmonics > size / 2 - 1)
+        {
+            harmonics = size / 2 - 1;
+        }
+        if (harmonics < 1)
+        {
+            harmonics = 1;
+        }
+
+        /* Fourier series of the naive waveforms computed by the oscillators */
+        build_harmonics(wavetables->tables[SQUARE_WAVE] + level * stride, sine, size,
+                        harmonics, true, false, 4.0 / M_PI, 1);
+        build_harmonics(wavetables->tables[TRIANGLE_WAVE] + level * stride, sine, size,
+                        harmonics, true, true, -8.0 / (M_PI * M_PI), 2);
+        build_harmonics(wavetables->tables[SAWTOOTH_WAVE] + level * stride, sine, size,
+                        harmonics, false, false, -2.0 / M_PI, 1);
+    }
+
+    return 0;
+}
+
+/* Free the wavetables */
+void wavetables_free(wavetables_t *wavetables)
+{
+    free(wavetables->memory);
+    wavetables->memory = NULL;
+}
+
+/* Returns the mip-map level of a waveform to use for the given frequency */
+int wavetable_level(const wavetables_t *wavetables, int wave, float freq)
+{
+    /* The smallest level whose top frequency is above the oscillator frequency */
+    int level = 0;
+    float top = WAVETABLE_BASE_FREQ;
+    while (top < freq && level < wavetables->levels[wave] - 1)
+    {
+        top *= 2.0f;
+        level++;
+    }
+    return level;
+}
+
+/* Read the first level of a waveform at a phase between 0 and 1, with linear interpolation */
+float wavetable_lookup(const wavetables_t *wavetables, int wave, float phase)
+{
+    const float *table = wavetables->tables[wave];
+    float position = phase * wavetables->size;
+    int index = (int)position;
+    float fraction = position - index;
+
+    return table[index] + fraction * (table[index + 1] - table[index]);
+}
@@ -15,13 +15,8 @@
  * - Amplification
  */
 int save_preset(
-    synth_t synth,
-    float attack, float decay,
-    float sustain, float release,
-    int wave_a, int wave_b, int wave_c,
-    char *preset_filename, bool *saving_preset,
-    bool distortion, bool overdrive, 
-    float distortion_amount)
+    const synth_params_t *params,
+    char *preset_filename, bool *saving_preset)
 {
 
     char filename[1024] = "presets/";
@@ -66,90 +61,105 @@ int save_preset(
         /* ADSR */
         adsr_node = xmlNewChild(root_node, NULL, BAD_CAST "adsr", NULL);
         /* Attack */
-        snprintf(text_element, 1024, "%.2f", attack);
+        snprintf(text_element, 1024, "%.2f", params->attack);
         xmlNewChild(adsr_node, NULL, BAD_CAST "attack", BAD_CAST text_element);
         /* Decay */
-        snprintf(text_element, 1024, "%.2f", decay);
+        snprintf(text_element, 1024, "%.2f", params->decay);
         xmlNewChild(adsr_node, NULL, BAD_CAST "decay", BAD_CAST text_element);
         /* Sustain */
-        snprintf(text_element, 1024, "%.2f", sustain);
+        snprintf(text_element, 1024, "%.2f", params->sustain);
         xmlNewChild(adsr_node, NULL, BAD_CAST "sustain", BAD_CAST text_element);
         /* Release */
-        snprintf(text_element, 1024, "%.2f", release);
+        snprintf(text_element, 1024, "%.2f", params->release);
         xmlNewChild(adsr_node, NULL, BAD_CAST "release", BAD_CAST text_element);
+        /* Exponential segments ON/OFF */
+        snprintf(text_element, 1024, "%d", params->exp_env);
+        xmlNewChild(adsr_node, NULL, BAD_CAST "exponential", BAD_CAST text_element);
 
         /* Filter */
         filter_node = xmlNewChild(root_node, NULL, BAD_CAST "filter", NULL);
         /* Filter ADSR */
         filter_adsr_node = xmlNewChild(filter_node, NULL, BAD_CAST "filter_adsr", NULL);
         /* Attack */
-        snprintf(text_element, 1024, "%.2f", *synth.filter->adsr->attack);
+        snprintf(text_element, 1024, "%.2f", params->filter_attack);
         xmlNewChild(filter_adsr_node, NULL, BAD_CAST "attack", BAD_CAST text_element);
         /* Decay */
-        snprintf(text_element, 1024, "%.2f", *synth.filter->adsr->decay);
+        snprintf(text_element, 1024, "%.2f", params->filter_decay);
         xmlNewChild(filter_adsr_node, NULL, BAD_CAST "decay", BAD_CAST text_element);
         /* Sustain */
-        snprintf(text_element, 1024, "%.2f", *synth.filter->adsr->sustain);
+        snprintf(text_element, 1024, "%.2f", params->filter_sustain);
         xmlNewChild(filter_adsr_node, NULL, BAD_CAST "sustain", BAD_CAST text_element);
         /* Release */
-        snprintf(text_element, 1024, "%.2f", *synth.filter->adsr->release);
+        snprintf(text_element, 1024, "%.2f", params->filter_release);
         xmlNewChild(filter_adsr_node, NULL, BAD_CAST "release", BAD_CAST text_element);
         /* Filter cutoff */
-        snprintf(text_element, 1024, "%.2f", synth.filter->cutoff);
+        snprintf(text_element, 1024, "%.2f", params->cutoff);
         xmlNewChild(filter_node, NULL, BAD_CAST "cutoff", BAD_CAST text_element);
         /* Filter envelope ON/OFF */
-        snprintf(text_element, 1024, "%d", synth.filter->env);
+        snprintf(text_element, 1024, "%d", params->filter_env);
         xmlNewChild(filter_node, NULL, BAD_CAST "envelope_on", BAD_CAST text_element);
+        /* Per-voice filters ON/OFF */
+        snprintf(text_element, 1024, "%d", params->voice_filters);
+        xmlNewChild(filter_node, NULL, BAD_CAST "voice_filters", BAD_CAST text_element);
+        /* Filter type */
+        snprintf(text_element, 1024, "%d", params->filter_type);
+        xmlNewChild(filter_node, NULL, BAD_CAST "type", BAD_CAST text_element);
+        /* Filter resonance */
+        snprintf(text_element, 1024, "%.2f", params->resonance);
+        xmlNewChild(filter_node, NULL, BAD_CAST "resonance", BAD_CAST text_element);
 
         /* Oscillators waveforms */
         osc_node = xmlNewChild(root_node, NULL, BAD_CAST "oscillators", NULL);
         /* Oscillator A */
-        snprintf(text_element, 1024, "%d", wave_a);
+        snprintf(text_element, 1024, "%d", params->waves[0]);
         xmlNewChild(osc_node, NULL, BAD_CAST "osc_a", BAD_CAST text_element);
         /* Oscillator B */
-        snprintf(text_element, 1024, "%d", wave_b);
+        snprintf(text_element, 1024, "%d", params->waves[1]);
         xmlNewChild(osc_node, NULL, BAD_CAST "osc_b", BAD_CAST text_element);
         /* Oscillator C */
-        snprintf(text_element, 1024, "%d", wave_c);
+        snprintf(text_element, 1024, "%d", params->waves[2]);
         xmlNewChild(osc_node, NULL, BAD_CAST "osc_c", BAD_CAST text_element);
 
         /* Effects */
         effects_node = xmlNewChild(root_node, NULL, BAD_CAST "effects", NULL);
         /* Detune */
-        snprintf(text_element, 1024, "%.2f", synth.detune);
+        snprintf(text_element, 1024, "%.2f", params->detune);
         xmlNewChild(effects_node, NULL, BAD_CAST "detune", BAD_CAST text_element);
         /* Amplification */
-        snprintf(text_element, 1024, "%.2f", synth.amp);
+        snprintf(text_element, 1024, "%.2f", params->amp);
         xmlNewChild(effects_node, NULL, BAD_CAST "amp", BAD_CAST text_element);
         /* Arpeggio */
-        snprintf(text_element, 1024, "%d", synth.arp);
+        snprintf(text_element, 1024, "%d", params->arp);
         xmlNewChild(effects_node, NULL, BAD_CAST "arp", BAD_CAST text_element);
         /* BPM */
-        snprintf(text_element, 1024, "%.2f", synth.bpm);
+        snprintf(text_element, 1024, "%.2f", params->bpm);
         xmlNewChild(effects_node, NULL, BAD_CAST "bpm", BAD_CAST text_element);
+        /* Glide */
+        snprintf(text_element, 1024, "%.2f", params->glide);
+        xmlNewChild(effects_node, NULL, BAD_CAST "glide", BAD_CAST text_element);
         
         /* LFO*/
         lfo_node = xmlNewChild(effects_node, NULL, BAD_CAST "lfo", NULL);
         /* LFO waveform */
-        snprintf(text_element, 1024, "%d", *synth.lfo->osc->wave);
+        snprintf(text_element, 1024, "%d", params->lfo_wave);
         xmlNewChild(lfo_node, NULL, BAD_CAST "lfo_wave", BAD_CAST text_element);
         /* LFO frequency */
-        snprintf(text_element, 1024, "%.2f", synth.lfo->osc->freq);
+        snprintf(text_element, 1024, "%.2f", params->lfo_freq);
         xmlNewChild(lfo_node, NULL, BAD_CAST "lfo_freq", BAD_CAST text_element);
         /* LFO parameter */
-        snprintf(text_element, 1024, "%d", synth.lfo->mod_param);
+        snprintf(text_element, 1024, "%d", params->lfo_param);
         xmlNewChild(lfo_node, NULL, BAD_CAST "lfo_param", BAD_CAST text_element);
 
         /* Distortion */
         distortion_node = xmlNewChild(effects_node, NULL, BAD_CAST "distortion", NULL);
         /* Distortion ON/OFF */
-        snprintf(text_element, 1024, "%d", distortion);
+        snprintf(text_element, 1024, "%d", params->distortion);
         xmlNewChild(distortion_node, NULL, BAD_CAST "dist_on_off", BAD_CAST text_element);
         /* Overdrive ON/OFF */
-        snprintf(text_element, 1024, "%d", overdrive);
+        snprintf(text_element, 1024, "%d", params->overdrive);
         xmlNewChild(distortion_node, NULL, BAD_CAST "od_on_off", BAD_CAST text_element);
         /* Distortion amount */
-        snprintf(text_element, 1024, "%.2f", distortion_amount);
+        snprintf(text_element, 1024, "%.2f", params->distortion_amount);
         xmlNewChild(distortion_node, NULL, BAD_CAST "amount", BAD_CAST text_element);
 
         /* Saving the XML document into the file */
@@ -171,12 +181,7 @@ int save_preset(
  * - Amplification
  */
 int load_preset(
-    synth_t *synth,
-    float *attack, float *decay,
-    float *sustain, float *release,
-    int *wave_a, int *wave_b, int *wave_c,
-    bool *distortion, bool *overdrive, 
-    float *distortion_amount, 
+    synth_params_t *params,
     bool *loading_preset)
 {
     char filename[1024];
@@ -219,35 +224,35 @@ int load_preset(
             xmlStrcmp(node->name, BAD_CAST "adsr") == 0)
         {
             parse_adsr(
-                node, synth, attack,
-                decay, sustain, release, false);
+                node, &params->attack, &params->decay,
+                &params->sustain, &params->release,
+                &params->exp_env);
         }
         /* Filter */
         else if (node->type == XML_ELEMENT_NODE &&
                  xmlStrcmp(node->name, BAD_CAST "filter") == 0)
         {
-            parse_filter(node, synth);
+            parse_filter(node, params);
         }
         /* Oscillators waveforms */
         else if (node->type == XML_ELEMENT_NODE &&
                  xmlStrcmp(node->name, BAD_CAST "oscillators") == 0)
         {
-            parse_oscillators(node, wave_a, wave_b, wave_c);
+            parse_oscillators(node, &params->waves[0],
+                &params->waves[1], &params->waves[2]);
         }
         /* Effects */
         else if (node->type == XML_ELEMENT_NODE &&
                  xmlStrcmp(node->name, BAD_CAST "effects") == 0)
         {
-            parse_effects(node, synth, 
-                distortion, overdrive, distortion_amount);    
+            parse_effects(node, params);
         }
     }
 
     return 0;
 }
 
-int parse_effects(xmlNode *effects_node, synth_t *synth,
-        bool *distortion, bool *overdrive, float *distortion_amount)
+int parse_effects(xmlNode *effects_node, synth_params_t *params)
 {
     xmlNode *child = NULL;
     /* Looping on effects */
@@ -274,7 +279,7 @@ int parse_effects(xmlNode *effects_node, synth_t *synth,
             {
                 detune_float = 0.0;
             }
-            synth->detune = detune_float;
+            params->detune = detune_float;
         }
         /* Amplification */
         else if (child->type == XML_ELEMENT_NODE &&
@@ -297,7 +302,7 @@ int parse_effects(xmlNode *effects_node, synth_t *synth,
             {
                 amp_float = 0.0;
             }
-            synth->amp = amp_float;
+            params->amp = amp_float;
         }
         else if (child->type == XML_ELEMENT_NODE &&
                 xmlStrcmp(child->name, BAD_CAST "arp") == 0)
@@ -319,7 +324,7 @@ int parse_effects(xmlNode *effects_node, synth_t *synth,
             {
                 arp_int = 0;
             }
-            synth->arp = arp_int;
+            params->arp = arp_int;
         }
         else if (child->type == XML_ELEMENT_NODE && 
                 xmlStrcmp(child->name, BAD_CAST "bpm") == 0)
@@ -341,27 +346,50 @@ int parse_effects(xmlNode *effects_node, synth_t *synth,
             {
                 bpm_float = 0.0;
             }
-            synth->bpm = bpm_float;
+            params->bpm = bpm_float;
+        }
+        /* Glide */
+        else if (child->type == XML_ELEMENT_NODE &&
+                xmlStrcmp(child->name, BAD_CAST "glide") == 0)
+        {
+            xmlChar *glide = xmlNodeGetContent(child);
+            char *end_ptr = NULL;
+            float glide_float = strtof((const char *)glide, &end_ptr);
+            if (end_ptr == (char *)glide)
+            {
+                fprintf(stderr, "bad glide value.\n");
+                return 1;
+            }
+
+            if (glide_float > MAX_GLIDE)
+            {
+                glide_float = MAX_GLIDE;
+            }
+            else if (glide_float < 0.0)
+            {
+                glide_float = 0.0;
+            }
+            params->glide = glide_float;
         }
         /* LFO */
         else if (child->type == XML_ELEMENT_NODE &&
                 xmlStrcmp(child->name, BAD_CAST "lfo") == 0)
         {
-            parse_lfo(child, synth);
+            parse_lfo(child, params);
         }
         /* Distortion */
         else if (child->type == XML_ELEMENT_NODE &&
                 xmlStrcmp(child->name, BAD_CAST "distortion") == 0)
         {
-            parse_distortion(child, distortion,
-                overdrive, distortion_amount);
+            parse_distortion(child, &params->distortion,
+                &params->overdrive, &params->distortion_amount);
         }
     }
     return 0;
 }
 
 int parse_filter(xmlNode *filter_node, 
-                synth_t *synth)
+                synth_params_t *params)
 {
     xmlNode *child = NULL;
 
@@ -372,8 +400,9 @@ int parse_filter(xmlNode *filter_node,
             xmlStrcmp(child->name, BAD_CAST "filter_adsr") == 0)
         {
             parse_adsr(
-                child, synth, NULL,
-                NULL, NULL, NULL, true);
+                child, &params->filter_attack, &params->filter_decay,
+                &params->filter_sustain, &params->filter_release,
+                NULL);
         }
         /* Filter cutoff */
         else if (child->type == XML_ELEMENT_NODE &&
@@ -396,7 +425,7 @@ int parse_filter(xmlNode *filter_node,
             {
                 cutoff_float = 0.0;
             }
-            synth->filter->cutoff = cutoff_float;
+            params->cutoff = cutoff_float;
         }
         /* Filter ADSR envelope ON/OFF */
         else if (child->type == XML_ELEMENT_NODE &&
@@ -419,7 +448,67 @@ int parse_filter(xmlNode *filter_node,
             {
                 env_on_int = 0;
             }
-            synth->filter->env = env_on_int;
+            params->filter_env = env_on_int;
+        }
+        /* Per-voice filters ON/OFF */
+        else if (child->type == XML_ELEMENT_NODE &&
+                    xmlStrcmp(child->name, BAD_CAST "voice_filters") == 0)
+        {
+            xmlChar *voice_filters = xmlNodeGetContent(child);
+            char *end_ptr = NULL;
+            int voice_filters_int = strtol((const char *)voice_filters, &end_ptr, 10);
+            if (end_ptr == (char *)voice_filters)
+            {
+                fprintf(stderr, "bad voice filters value.\n");
+                return 1;
+            }
+            params->voice_filters = voice_filters_int > 0;
+        }
+        /* Filter type */
+        else if (child->type == XML_ELEMENT_NODE &&
+                    xmlStrcmp(child->name, BAD_CAST "type") == 0)
+        {
+            xmlChar *type = xmlNodeGetContent(child);
+            char *end_ptr = NULL;
+            int type_int = strtol((const char *)type, &end_ptr, 10);
+            if (end_ptr == (char *)type)
+            {
+                fprintf(stderr, "bad filter type value.\n");
+                return 1;
+            }
+
+            if (type_int > LADDER_FILTER)
+            {
+                type_int = LADDER_FILTER;
+            }
+            else if (type_int < ONE_POLE_FILTER)
+            {
+                type_int = ONE_POLE_FILTER;
+            }
+            params->filter_type = type_int;
+        }
+        /* Filter resonance */
+        else if (child->type == XML_ELEMENT_NODE &&
+                    xmlStrcmp(child->name, BAD_CAST "resonance") == 0)
+        {
+            xmlChar *resonance = xmlNodeGetContent(child);
+            char *end_ptr = NULL;
+            float resonance_float = strtof((const char *)resonance, &end_ptr);
+            if (end_ptr == (char *)resonance)
+            {
+                fprintf(stderr, "bad resonance value.\n");
+                return 1;
+            }
+
+            if (resonance_float > 1.0)
+            {
+                resonance_float = 1.0;
+            }
+            else if (resonance_float < 0.0)
+            {
+                resonance_float = 0.0;
+            }
+            params->resonance = resonance_float;
         }
     }
     return 0;
@@ -504,7 +593,7 @@ int parse_oscillators(xmlNode *lfo_node,
     return 0;
 }
 
-int parse_lfo(xmlNode *lfo_node, synth_t *synth)
+int parse_lfo(xmlNode *lfo_node, synth_params_t *params)
 {
     xmlNode *lfo_child = NULL;
                     
@@ -531,7 +620,7 @@ int parse_lfo(xmlNode *lfo_node, synth_t *synth)
             {
                 lfo_wave_int = SINE_WAVE;
             }
-            *synth->lfo->osc->wave = lfo_wave_int;
+            params->lfo_wave = lfo_wave_int;
         }
         else if (lfo_child->type == XML_ELEMENT_NODE &&
                 xmlStrcmp(lfo_child->name, BAD_CAST "lfo_freq") == 0)
@@ -553,7 +642,7 @@ int parse_lfo(xmlNode *lfo_node, synth_t *synth)
             {
                 lfo_freq_float = 0.0;
             }
-            synth->lfo->osc->freq = lfo_freq_float;
+            params->lfo_freq = lfo_freq_float;
         }
         else if (lfo_child->type == XML_ELEMENT_NODE &&
                 xmlStrcmp(lfo_child->name, BAD_CAST "lfo_param") == 0)
@@ -575,7 +664,7 @@ int parse_lfo(xmlNode *lfo_node, synth_t *synth)
             {
                 lfo_param_int = LFO_OFF;
             }
-            synth->lfo->mod_param = lfo_param_int;
+            params->lfo_param = lfo_param_int;
         }
     }
     return 0;
@@ -662,13 +751,15 @@ int parse_distortion(xmlNode *distortion_node,
     return 0;
 }
 
-/* Parse an ADSR XML Node whether it's basic ADSR of filter ADSR */
+/*
+ * Parse an ADSR XML Node whether it's basic ADSR of filter ADSR
+ * The exponential segments ON/OFF is only read if exponential isn't NULL
+ */
 int parse_adsr(
     xmlNode *adsr_root_node,
-    synth_t *synth,
     float *attack, float *decay,
     float *sustain, float *release,
-    bool filter)
+    bool *exponential)
 {
     xmlNode *child = NULL;
     /* Looping throught the child of the ADSR root node*/
@@ -695,14 +786,7 @@ int parse_adsr(
                 attack_float = 0.0;
             }
             
-            if (filter)
-            {
-                *synth->filter->adsr->attack = attack_float;
-            }
-            else
-            {
-                *attack = attack_float;
-            }
+            *attack = attack_float;
         }
         /* Decay Node */
         else if (child->type == XML_ELEMENT_NODE &&
@@ -726,14 +810,7 @@ int parse_adsr(
 
             }
                 
-            if (filter)
-            {
-                *synth->filter->adsr->decay = decay_float;
-            }
-            else
-            {
-                *decay = decay_float;
-            }
+            *decay = decay_float;
         }
         /* Sustain Node */
         else if (child->type == XML_ELEMENT_NODE &&
@@ -756,14 +833,7 @@ int parse_adsr(
                 sustain_float = 0.0;
             }
 
-            if (filter)
-            {
-                *synth->filter->adsr->sustain = sustain_float;
-            }
-            else
-            {
-                *sustain = sustain_float;
-            }
+            *sustain = sustain_float;
         }
         /* Release Node */
         else if (child->type == XML_ELEMENT_NODE &&
@@ -786,14 +856,22 @@ int parse_adsr(
                 release_float = 0.0;
             }
 
-            if (filter)
-            {
-                *synth->filter->adsr->release = release_float;
-            }
-            else
+            *release = release_float;
+        }
+        /* Exponential segments ON/OFF Node */
+        else if (exponential != NULL &&
+                 child->type == XML_ELEMENT_NODE &&
+                 xmlStrcmp(child->name, BAD_CAST "exponential") == 0)
+        {
+            xmlChar *exponential_str = xmlNodeGetContent(child);
+            char *end_ptr = NULL;
+            int exponential_int = strtol((const char *)exponential_str, &end_ptr, 10);
+            if (end_ptr == (char *)exponential_str)
             {
-                *release = release_float;
+                fprintf(stderr, "bad exponential value.\n");
+                return 1;
             }
+            *exponential = exponential_int > 0;
         }
     }
     return 0;
@@ -0,0 +1,74 @@
+#include "defs.h"
+#include "synth.h"
+#include "pitch.h"
+
+/*
+ * Notes outside the MIDI range must not reach the voices pool,
+ * its maps are indexed by the note
+ */
+int main(void)
+{
+    synth_params_t params = {.sustain = 0.7, .cutoff = 0.5, .amp = DEFAULT_AMPLITUDE};
+    lp_filter_t filter = {.rate = DEFAULT_RATE};
+    lfo_t lfo = {0};
+    voices_t voices;
+
+    pitch_init();
+    if (voices_init(&voices, VOICES) != 0)
+    {
+        fprintf(stderr, "memory allocation failed.\n");
+        return 1;
+    }
+
+    synth_t synth =
+        {
+            .voices = &voices,
+            .params = &params,
+            .filter = &filter,
+            .lfo = &lfo,
+            .bend = 1.0,
+            .last_pitch = -1.0,
+            .rate = DEFAULT_RATE,
+            .control_rate = CONTROL_RATE};
+
+    int free_head = voices.free.head;
+    int busy_head = voices.busy.head;
+    const int notes[] = {-1, MIDI_NOTES};
+    for (int n = 0; n < 2; n++)
+    {
+        synth_note_on(&synth, notes[n], 100);
+        synth_note_off(&synth, notes[n]);
+    }
+
+    int failed = 0;
+    if (voices.pressed_count != 0 || voices.active_count != 0 ||
+        voices.free.head != free_head || voices.busy.head != busy_head)
+    {
+        fprintf(stderr, "a note outside the MIDI range reached the voices.\n");
+        failed = 1;
+    }
+    for (int n = 0; n < MIDI_NOTES; n++)
+    {
+        if (voices.note_voice[n] != -1)
+        {
+            fprintf(stderr, "a note outside the MIDI range took the voice of the note %d.\n", n);
+            failed = 1;
+        }
+    }
+
+    /* The range bounds still play */
+    synth_note_on(&synth, 0, 100);
+    synth_note_on(&synth, MIDI_NOTES - 1, 100);
+    if (voices.pressed_count != 2 || voices.note_voice[0] == -1 || voices.note_voice[MIDI_NOTES - 1] == -1)
+    {
+        fprintf(stderr, "the notes 0 and 127 weren't pressed.\n");
+        failed = 1;
+    }
+
+    voices_free(&voices);
+    if (!failed)
+    {
+        printf("note range test passed.\n");
+    }
+    return failed;
+}